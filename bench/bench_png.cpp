@@ -0,0 +1,83 @@
+/*
+ * GitZipQR.cpp – PNG writer benchmark
+ *
+ * Renders one v40 code (random payload, default margin/scale) with the
+ * pre-1-bit writer and with every writer mode / zlib setting of interest,
+ * and reports bytes per image and ms per image.
+ *
+ *   make bench            # or: build/bench_png [images]
+ */
+#include "src/png_writer.hpp"
+#include "config.hpp"
+
+#include <chrono>
+#include <filesystem>
+#include <qrencode.h>
+#include <openssl/rand.h>
+
+using namespace gzqr;
+
+// The writer as it was before 1-bit mode: full RGBA buffer, per-pixel set_px.
+static void legacy_write_qr_png(const std::string& out,QRcode* qrcode,int margin,int scale){
+  const int qsize=qrcode->width;
+  const int img_size=(qsize+2*margin)*scale;
+  std::vector<uint8_t> rgba((size_t)img_size*img_size*4,0xFF);
+  auto set_px=[&](int x,int y,uint8_t v){
+    if(x<0||y<0||x>=img_size||y>=img_size) return;
+    size_t off=((size_t)y*img_size+x)*4;
+    rgba[off]=v; rgba[off+1]=v; rgba[off+2]=v; rgba[off+3]=0xFF;
+  };
+  const unsigned char* data=qrcode->data;
+  for(int my=0;my<qsize;++my) for(int mx=0;mx<qsize;++mx){
+    uint8_t v=(data[my*qsize+mx]&1)?0:255;
+    int px0=(margin+mx)*scale,py0=(margin+my)*scale;
+    for(int dy=0;dy<scale;dy++) for(int dx=0;dx<scale;dx++) set_px(px0+dx,py0+dy,v);
+  }
+  FILE* fp=fopen(out.c_str(),"wb"); if(!fp) throw std::runtime_error("open png");
+  png_structp png_ptr=png_create_write_struct(PNG_LIBPNG_VER_STRING,nullptr,nullptr,nullptr);
+  png_infop info_ptr=png_create_info_struct(png_ptr);
+  if(setjmp(png_jmpbuf(png_ptr))){ png_destroy_write_struct(&png_ptr,&info_ptr); fclose(fp); throw std::runtime_error("png write"); }
+  png_init_io(png_ptr,fp);
+  png_set_IHDR(png_ptr,info_ptr,img_size,img_size,8,PNG_COLOR_TYPE_RGBA,PNG_INTERLACE_NONE,PNG_COMPRESSION_TYPE_DEFAULT,PNG_FILTER_TYPE_DEFAULT);
+  png_write_info(png_ptr,info_ptr);
+  std::vector<png_bytep> rows(img_size); for(int y=0;y<img_size;y++) rows[y]=(png_bytep)&rgba[(size_t)y*img_size*4];
+  png_write_image(png_ptr,rows.data()); png_write_end(png_ptr,nullptr);
+  png_destroy_write_struct(&png_ptr,&info_ptr); fclose(fp);
+}
+
+int main(int argc,char** argv){
+  int n=argc>1?std::atoi(argv[1]):20;
+  const int M=gzqr_config::kDefaultQRMargin, S=gzqr_config::kDefaultQRScale;
+  std::vector<uint8_t> payload(2900); RAND_bytes(payload.data(),(int)payload.size());
+  QRcode* q=QRcode_encodeData((int)payload.size(),payload.data(),gzqr_config::kDefaultQRVersion,QR_ECLEVEL_L);
+  if(!q){ std::fprintf(stderr,"QR encode failed\n"); return 1; }
+  auto dir=std::filesystem::temp_directory_path()/"gzqr-bench-png";
+  std::filesystem::create_directories(dir);
+  std::string path=(dir/"x.png").string();
+
+  auto run=[&](const char* label,const std::function<void()>& fn){
+    fn(); // warm-up
+    auto t0=std::chrono::steady_clock::now();
+    for(int i=0;i<n;i++) fn();
+    double ms=std::chrono::duration<double,std::milli>(std::chrono::steady_clock::now()-t0).count()/n;
+    std::printf("%-28s %9ju bytes %8.2f ms/image\n",label,(uintmax_t)std::filesystem::file_size(path),ms);
+  };
+  std::printf("v%d %dx%d modules, margin=%d scale=%d, %d images per row\n",q->version,q->width,q->width,M,S,n);
+  run("legacy rgba (old writer)",[&]{ legacy_write_qr_png(path,q,M,S); });
+  struct cfg { const char* label; png_opts o; };
+  const cfg cfgs[]={
+    {"rgba  libpng defaults",  {kPngRGBA, -1,-1,-1}},
+    {"gray1 libpng defaults",  {kPngGray1,-1,-1,-1}},
+    {"gray1 z9 default",   {kPngGray1,9,Z_DEFAULT_STRATEGY,-1}},
+    {"gray1 z6 none",      {kPngGray1,6,Z_DEFAULT_STRATEGY,PNG_FILTER_NONE}},
+    {"gray1 z6 up",        {kPngGray1,6,Z_DEFAULT_STRATEGY,PNG_FILTER_UP}},
+    {"gray1 z9 up rle",    {kPngGray1,9,Z_RLE,PNG_FILTER_UP}},
+    {"gray1 z1 up rle",    {kPngGray1,1,Z_RLE,PNG_FILTER_UP}},
+    {"gray1 z1 none",      {kPngGray1,1,Z_DEFAULT_STRATEGY,PNG_FILTER_NONE}},
+    {"gray1 z0 none",      {kPngGray1,0,Z_DEFAULT_STRATEGY,PNG_FILTER_NONE}},
+  };
+  for(const auto& c:cfgs) run(c.label,[&]{ write_qr_png(path,q->data,q->width,M,S,c.o); });
+  QRcode_free(q);
+  std::filesystem::remove_all(dir);
+  return 0;
+}
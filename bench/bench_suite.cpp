@@ -0,0 +1,368 @@
+/*
+ * GitZipQR.cpp – benchmark suite
+ *
+ * Kernels: b64, b64d, sha256_hex, scrypt_kdf, aes_gcm_encrypt_file,
+ * write_qr_png, png_read, decode_qr and the dump/parse of a v1 JSON chunk
+ * (chunk_json.hpp, checked byte for byte against mini_json), every GF(2^8) parity kernel and every base64/hex kernel the CPU
+ * supports (checked against the scalar or reference code first). Each one
+ * runs until at least ~0.3 s has passed.
+ *
+ * End to end: generates corpora (tiny file, random, text, a many-file
+ * directory), runs build/encode and build/decode on each, checks that the
+ * output matches the input, and reports MB/s, images/s and peak RSS of
+ * each child process. An indexed archive of a directory plus one large
+ * file is restored in full and, with --extract, one small file out of it.
+ * An incremental archive whose blocks are resealed with another --compress
+ * must get new GCM nonces for them and still decode.
+ *
+ * Every metric is written to a flat JSON file. Keep one run as a baseline
+ * and pass it back with --baseline to get per-metric deltas. Changes past
+ * ±5% in the bad direction are flagged.
+ *
+ *   make bench                                   # full corpora (100 MB, 50k files)
+ *   make bench BENCH_ARGS=--quick                # small corpora
+ *   make bench BASELINE=bench/baseline.json      # diff against a saved run
+ *   build/bench_suite [--bin DIR] [--quick] [--only kernels|e2e] [--json OUT] [--baseline IN]
+ */
+#include "src/common.hpp"
+#include "src/png_writer.hpp"
+#include "src/qr_reader.hpp"
+#include "src/erasure.hpp"
+#include "src/text_codec.hpp"
+#include "src/chunk_json.hpp"
+#include "src/chunk_format.hpp"
+#include "src/cdc.hpp"
+#include "third_party/json.hpp"
+#include "config.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+#include <qrencode.h>
+#include <openssl/rand.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace gzqr;
+namespace fs=std::filesystem;
+
+// ---------------- Results ----------------
+struct metric { double value; std::string unit; bool higherBetter; };
+static std::map<std::string,metric> g_results;
+
+static void report(const std::string& name,double v,const char* unit,bool higherBetter=true){
+  g_results[name]={v,unit,higherBetter};
+  std::printf("  %-34s %12.2f %s\n",name.c_str(),v,unit);
+}
+
+// Calls fn until ≥ minSec have passed; returns seconds per call.
+static double time_per_call(const std::function<void()>& fn,double minSec=0.3){
+  fn(); // warm-up
+  int n=0; auto t0=std::chrono::steady_clock::now(); double el=0;
+  do{ fn(); n++; el=std::chrono::duration<double>(std::chrono::steady_clock::now()-t0).count(); }while(el<minSec);
+  return el/n;
+}
+
+// ---------------- Kernels ----------------
+// The byte-at-a-time base64/hex from before text_codec.hpp, as the reference.
+static std::string ref_b64(const std::vector<uint8_t>& in){
+  static const char* t="ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  std::string o; size_t i=0;
+  for(;i+3<=in.size();i+=3){ uint32_t v=(in[i]<<16)|(in[i+1]<<8)|in[i+2]; for(int k=18;k>=0;k-=6) o.push_back(t[(v>>k)&63]); }
+  if(i+1==in.size()){ uint32_t v=in[i]<<16; o+=t[v>>18]; o+=t[(v>>12)&63]; o+="=="; }
+  else if(i+2==in.size()){ uint32_t v=(in[i]<<16)|(in[i+1]<<8); o+=t[v>>18]; o+=t[(v>>12)&63]; o+=t[(v>>6)&63]; o+='='; }
+  return o;
+}
+static std::vector<uint8_t> ref_b64d(const std::string& s){
+  static const std::string tab="ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  std::vector<uint8_t> o; int val=0,valb=-8;
+  for(unsigned char c:s){ size_t d=tab.find((char)c); if(d==std::string::npos){ if(c=='=') break; continue; }
+    val=(val<<6)+(int)d; valb+=6; if(valb>=0){ o.push_back((uint8_t)((val>>valb)&255)); valb-=8; } }
+  return o;
+}
+static std::string ref_hex(const std::vector<uint8_t>& in){
+  std::string s; for(uint8_t b:in){ s+="0123456789abcdef"[b>>4]; s+="0123456789abcdef"[b&15]; } return s;
+}
+// Every text kernel against the reference: all short sizes, 1 MiB, and
+// decoder input with line breaks, stray bytes and early padding.
+static void check_text_kernel(const text::kernel& k,const std::vector<uint8_t>& buf){
+  auto fail=[&](const char* what,size_t n){ throw std::runtime_error(std::string("text kernel mismatch: ")+k.name+" "+what+" n="+std::to_string(n)); };
+  auto dec=[&](const std::string& e){ std::vector<uint8_t> d(text::b64_decoded_max(e.size())); d.resize(k.b64_decode(e.data(),e.size(),d.data())); return d; };
+  std::mt19937_64 rng(17);
+  std::vector<size_t> sizes; for(size_t n=0;n<=300;n++) sizes.push_back(n); sizes.push_back(buf.size());
+  for(size_t n:sizes){
+    std::vector<uint8_t> in(buf.begin(),buf.begin()+n);
+    std::string e(text::b64_size(n),'\0');
+    if(k.b64_encode(in.data(),n,e.data())!=e.size() || e!=ref_b64(in)) fail("b64",n);
+    if(dec(e)!=in) fail("b64d",n);
+    std::string h(2*n,'\0'); k.hex_encode(in.data(),n,h.data()); if(h!=ref_hex(in)) fail("hex",n);
+    std::string m=e;                      // noise the scalar path has to skip
+    for(size_t j=0;j<m.size()/40;j++){ size_t at=rng()%(m.size()+1); m.insert(at,1,"\n\r -*\x80"[rng()%6]); }
+    if(dec(m)!=ref_b64d(m)) fail("b64d noisy",n);
+    if(n>8){ std::string t=e; t.insert(t.size()/2,"="); if(dec(t)!=ref_b64d(t)) fail("b64d padding",n); }
+  }
+}
+
+static void bench_kernels(const fs::path& tmp){
+  std::printf("kernels\n");
+  const size_t MB=1<<20;
+  std::vector<uint8_t> buf(MB); RAND_bytes(buf.data(),(int)buf.size());
+
+  std::string enc;
+  report("b64.MBps",MB/1e6/time_per_call([&]{ enc=b64(buf); }),"MB/s");
+  report("b64d.MBps",MB/1e6/time_per_call([&]{ auto d=b64d(enc); if(d.size()!=MB) throw std::runtime_error("b64d"); }),"MB/s");
+  report("sha256_hex.MBps",MB/1e6/time_per_call([&]{ auto h=sha256_hex(buf); }),"MB/s");
+
+  for(const auto& k:text::kernels()){
+    check_text_kernel(k,buf);
+    std::string e(text::b64_size(MB),'\0'), h(2*MB,'\0'); std::vector<uint8_t> d(text::b64_decoded_max(e.size()));
+    report(std::string("b64.")+k.name+".MBps",MB/1e6/time_per_call([&]{ k.b64_encode(buf.data(),MB,e.data()); }),"MB/s");
+    report(std::string("b64d.")+k.name+".MBps",MB/1e6/time_per_call([&]{ if(k.b64_decode(e.data(),e.size(),d.data())!=MB) throw std::runtime_error("b64d"); }),"MB/s");
+    report(std::string("hex.")+k.name+".MBps",MB/1e6/time_per_call([&]{ k.hex_encode(buf.data(),MB,h.data()); }),"MB/s");
+  }
+
+  {
+    std::vector<uint8_t> ref(MB,0), acc(MB,0);
+    gf::mul_add_scalar(ref.data(),buf.data(),MB-3,0x53);
+    for(const auto& k:gf::kernels()){
+      std::fill(acc.begin(),acc.end(),0); k.fn(acc.data(),buf.data(),MB-3,0x53);
+      if(acc!=ref) throw std::runtime_error(std::string("gf kernel mismatch: ")+k.name);
+      report(std::string("gf_mul_add.")+k.name+".MBps",MB/1e6/time_per_call([&]{ k.fn(acc.data(),buf.data(),MB,0x53); }),"MB/s");
+    }
+  }
+
+  std::vector<uint8_t> salt(16,7);
+  KDFParams kdf{(1u<<15),8u,1u};
+  report("scrypt_kdf.ms",1e3*time_per_call([&]{ auto k=scrypt_kdf("benchmark-pass",salt,kdf); },1.0),"ms",false);
+
+  {
+    const size_t n=32*MB; std::string in=(tmp/"aes.in").string(), out=(tmp/"aes.out").string();
+    std::vector<uint8_t> big(n); RAND_bytes(big.data(),(int)n); write_all(in,big);
+    std::vector<uint8_t> key(32,1), nonce(12,2);
+    report("aes_gcm_encrypt_file.MBps",n/1e6/time_per_call([&]{ aes_gcm_encrypt_file(in,out,key,nonce,{}); }),"MB/s");
+    fs::remove(in); fs::remove(out);
+  }
+
+  // One full v40-L code, as the encoder writes them.
+  const int M=gzqr_config::kDefaultQRMargin, S=gzqr_config::kDefaultQRScale;
+  std::vector<uint8_t> payload(2900); RAND_bytes(payload.data(),(int)payload.size());
+  QRcode* q=QRcode_encodeData((int)payload.size(),payload.data(),gzqr_config::kDefaultQRVersion,QR_ECLEVEL_L);
+  if(!q) throw std::runtime_error("QR encode failed");
+  std::string png=(tmp/"qr.png").string();
+  png_opts po; parse_png_mode(gzqr_config::kDefaultPngMode,po.mode);
+  report("qr_encode.imgps",1/time_per_call([&]{ QRcode* t=QRcode_encodeData((int)payload.size(),payload.data(),gzqr_config::kDefaultQRVersion,QR_ECLEVEL_L); QRcode_free(t); }),"img/s");
+  report("write_qr_png.imgps",1/time_per_call([&]{ write_qr_png(png,q->data,q->width,M,S,po); }),"img/s");
+  QRcode_free(q);
+  raster r;
+  report("png_read.imgps",1/time_per_call([&]{ r=png_read(png); }),"img/s");
+  report("decode_qr.imgps",1/time_per_call([&]{ if(decode_qr(r).size()!=payload.size()) throw std::runtime_error("decode_qr"); }),"img/s");
+
+  // A v1 chunk object, the largest JSON the tool handles. mini_json wrote
+  // these before chunk_json.hpp; the output has to stay byte-identical.
+  const std::vector<uint8_t> data(buf.begin(),buf.begin()+2100);
+  const std::string type=std::string(gzqr_config::kProjectName)+"-CHUNK-ENC", cipherHash(64,'b'), saltB64=b64(salt), nonceB64=b64(std::vector<uint8_t>(12));
+  chunkjson::fields f;
+  f.type=type; f.version=gzqr_config::kProjectVersion; f.chunk=123; f.total=4567; f.chunkSize=2100;
+  f.cipherHash=cipherHash; f.saltB64=saltB64; f.nonceB64=nonceB64; f.name="arch\"ive"; f.ext=".zip"; f.codec="deflate";
+  std::map<std::string,mini_json::value> m;
+  m["type"]=type; m["version"]=gzqr_config::kProjectVersion;
+  m["chunk"]=123.0; m["total"]=4567.0; m["hash"]=sha256_hex(data); m["cipherHash"]=cipherHash;
+  m["saltB64"]=saltB64; m["nonceB64"]=nonceB64; m["name"]="arch\"ive"; m["ext"]=".zip"; m["codec"]="deflate";
+  m["chunkSize"]=2100.0; m["dataB64"]=b64(data);
+  std::string js;
+  chunkjson::write(js,f,data.data(),data.size());
+  if(js!=mini_json::value(m).dump()) throw std::runtime_error("chunk_json output differs from mini_json");
+  chunkjson::view v; chunkjson::parse(js,v);
+  if((v.seen&chunkjson::view::kRequired)!=chunkjson::view::kRequired || v.chunk!=123 || b64d(std::string(v.dataB64))!=data || chunkjson::unescape(v.name)!="arch\"ive")
+    throw std::runtime_error("chunk_json parse mismatch");
+  report("json_dump.MBps",js.size()/1e6/time_per_call([&]{ chunkjson::write(js,f,data.data(),data.size()); }),"MB/s");
+  report("json_parse.MBps",js.size()/1e6/time_per_call([&]{ chunkjson::parse(js,v); }),"MB/s");
+}
+
+// ---------------- End to end ----------------
+struct run_result { double sec; long maxRssKB; int status; };
+
+// fork/exec with GZQR_PASS set; wall time and the child's own peak RSS.
+static run_result run_child(const std::vector<std::string>& argv){
+  std::vector<char*> a; for(auto& s:argv) a.push_back(const_cast<char*>(s.c_str())); a.push_back(nullptr);
+  std::fflush(stdout);
+  auto t0=std::chrono::steady_clock::now();
+  pid_t pid=fork();
+  if(pid<0) throw std::runtime_error("fork");
+  if(pid==0){
+    setenv("GZQR_PASS","benchmark-pass",1);
+    if(!freopen("/dev/null","w",stdout)) _exit(127);
+    execv(a[0],a.data()); _exit(127);
+  }
+  int st=0; rusage ru{}; wait4(pid,&st,0,&ru);
+  return { std::chrono::duration<double>(std::chrono::steady_clock::now()-t0).count(), ru.ru_maxrss, st };
+}
+
+static void gen_random(const fs::path& p,size_t n,uint64_t seed){
+  std::mt19937_64 g(seed); std::vector<uint8_t> b(1<<20); FILE* f=fopen(p.c_str(),"wb");
+  while(n){ size_t k=std::min(n,b.size()); for(size_t i=0;i<k;i+=8){ uint64_t v=g(); std::memcpy(&b[i],&v,std::min<size_t>(8,k-i)); } fwrite(b.data(),1,k,f); n-=k; }
+  fclose(f);
+}
+// Word salad over a small Zipf-ish vocabulary: compresses roughly like prose/logs.
+static void gen_text(const fs::path& p,size_t n,uint64_t seed){
+  static const char* W[]={"the","of","and","to","in","a","is","that","for","it","as","was","with","be","by","on","not","he",
+    "this","are","or","his","from","at","which","but","have","an","had","they","you","were","their","one","all","we","can",
+    "chunk","encode","decode","archive","backup","error","warning","info","request","response","value","index","total"};
+  const int nw=sizeof(W)/sizeof(*W);
+  std::mt19937_64 g(seed); std::string s; s.reserve((1<<20)+64); FILE* f=fopen(p.c_str(),"wb"); size_t done=0; int col=0;
+  while(done<n){
+    s.clear();
+    while(s.size()<(1<<20)){ int k=(int)(std::min<uint64_t>(g()%nw,g()%nw)); s+=W[k]; col+=(int)std::strlen(W[k])+1; if(col>72){ s+='\n'; col=0; } else s+=' '; }
+    size_t k=std::min(n-done,s.size()); fwrite(s.data(),1,k,f); done+=k;
+  }
+  fclose(f);
+}
+static void gen_tree(const fs::path& root,int files,uint64_t seed){
+  std::mt19937_64 g(seed);
+  for(int i=0;i<files;i++){
+    fs::path d=root/("d"+std::to_string(i/500))/("e"+std::to_string((i/50)%10));
+    if(i%50==0) fs::create_directories(d);
+    std::string body="file "+std::to_string(i)+" "+std::string(g()%200,'x'+(char)(i%3))+"\n";
+    FILE* f=fopen((d/("f"+std::to_string(i)+".txt")).c_str(),"wb"); fwrite(body.data(),1,body.size(),f); fclose(f);
+  }
+}
+static uint64_t tree_bytes(const fs::path& p){
+  if(!fs::is_directory(p)) return fs::file_size(p);
+  uint64_t n=0; for(auto& e:fs::recursive_directory_iterator(p)) if(e.is_regular_file()) n+=e.file_size(); return n;
+}
+static bool same_file(const fs::path& a,const fs::path& b){
+  if(!fs::exists(b) || fs::file_size(a)!=fs::file_size(b)) return false;
+  return sha256_hex_file(a.string())==sha256_hex_file(b.string());
+}
+
+static void bench_e2e(const fs::path& tmp,const std::string& bin,bool quick){
+  std::printf("end to end (%s corpora)\n",quick?"quick":"full");
+  const size_t big=quick?(4u<<20):(100u<<20); const int nfiles=quick?2000:50000;
+  struct corpus { const char* name; std::function<void(const fs::path&)> gen; bool dir; };
+  const corpus cs[]={
+    {"tiny",  [&](const fs::path& p){ gen_text(p,100,1); },false},
+    {"random",[&](const fs::path& p){ gen_random(p,big,2); },false},
+    {"text",  [&](const fs::path& p){ gen_text(p,big,3); },false},
+    {"files", [&](const fs::path& p){ gen_tree(p,nfiles,4); },true},
+  };
+  for(const auto& c:cs){
+    fs::path in=tmp/"in"/c.name, qr=tmp/"qr"/c.name, out=tmp/"out"/c.name;
+    fs::create_directories(in.parent_path()); c.gen(in);
+    const double mb=tree_bytes(in)/1e6;
+    auto e=run_child({bin+"/encode",in.string(),qr.string()});
+    if(e.status!=0) throw std::runtime_error(std::string("encode failed on ")+c.name);
+    int images=0; for(auto& f:fs::directory_iterator(qr)) images+=f.path().extension()==".png";
+    auto d=run_child({bin+"/decode",qr.string(),out.string()});
+    if(d.status!=0) throw std::runtime_error(std::string("decode failed on ")+c.name);
+    // Files must match byte for byte; a directory comes back as <name>.zip.
+    bool ok=c.dir ? fs::exists(out/(std::string(c.name)+".zip")) : same_file(in,out/c.name);
+    if(!ok) throw std::runtime_error(std::string("round trip mismatch on ")+c.name);
+    std::string k=std::string("e2e.")+c.name+".";
+    report(k+"codes",images,"codes",false);
+    report(k+"encode.MBps",mb/e.sec,"MB/s");
+    report(k+"encode.imgps",images/e.sec,"img/s");
+    report(k+"encode.peakRssMB",e.maxRssKB/1024.0,"MB",false);
+    report(k+"decode.MBps",mb/d.sec,"MB/s");
+    report(k+"decode.imgps",images/d.sec,"img/s");
+    report(k+"decode.peakRssMB",d.maxRssKB/1024.0,"MB",false);
+    fs::remove_all(in); fs::remove_all(qr); fs::remove_all(out);
+  }
+  // Indexed archive: one small file out of a large directory (--extract)
+  // against restoring the whole thing.
+  {
+    fs::path in=tmp/"in"/"indexed", qr=tmp/"qr"/"indexed", out=tmp/"out"/"indexed";
+    gen_tree(in,nfiles,5); gen_random(in/"big.bin",big,6);
+    const double mb=tree_bytes(in)/1e6;
+    if(run_child({bin+"/encode",in.string(),qr.string(),"--indexed"}).status!=0) throw std::runtime_error("encode failed on indexed");
+    auto d=run_child({bin+"/decode",qr.string(),out.string()});
+    if(d.status!=0 || !fs::exists(out/"indexed.zip")) throw std::runtime_error("decode failed on indexed");
+    auto x=run_child({bin+"/decode",qr.string(),(out/"x").string(),"--extract","d0/e0/f0.txt"});
+    if(x.status!=0 || !same_file(in/"d0/e0/f0.txt",out/"x/d0/e0/f0.txt")) throw std::runtime_error("extract mismatch on indexed");
+    report("e2e.indexed.decode.MBps",mb/d.sec,"MB/s");
+    report("e2e.indexed.extract.ms",x.sec*1e3,"ms",false);
+    fs::remove_all(in); fs::remove_all(qr); fs::remove_all(out);
+  }
+  // Incremental re-encode: gzqr-index.txt keeps the salt, so the block key
+  // stays the same. Blocks sealed again with another --compress must not
+  // reuse a nonce.
+  {
+    fs::path in=tmp/"in"/"incr.txt", qr=tmp/"qr"/"incr", out=tmp/"out"/"incr";
+    fs::create_directories(in.parent_path()); gen_text(in,256<<10,7);
+    auto nonces=[&]{   // first code of each block → its nonce
+      std::map<std::string,std::string> n;
+      for(auto& f:fs::directory_iterator(qr)){
+        const std::string fn=f.path().filename().string();
+        if(fn.rfind("qr-b",0)!=0 || fn.size()<6 || fn.compare(fn.size()-6,6,"-0.png")!=0) continue;
+        std::string raw=decode_qr(png_read(f.path().string())); chunkfmt::chunk_view cv;
+        if(!chunkfmt::parse((const uint8_t*)raw.data(),raw.size(),cv) || cv.size<cdc::kIdSize+cdc::kNonceSize) throw std::runtime_error("bad block code "+fn);
+        n[fn].assign((const char*)cv.body+cdc::kIdSize,cdc::kNonceSize);
+      }
+      return n;
+    };
+    auto encode=[&](const char* comp){
+      if(run_child({bin+"/encode","--incremental",in.string(),qr.string(),"--compress",comp}).status!=0) throw std::runtime_error("encode failed on incremental");
+    };
+    encode("none"); auto before=nonces();
+    for(auto& [fn,n]:before) fs::remove(qr/fn);
+    encode("deflate:9"); auto after=nonces();
+    if(before.empty() || after.size()!=before.size()) throw std::runtime_error("incremental re-encode changed the blocks");
+    for(auto& [fn,n]:before) if(after.at(fn)==n) throw std::runtime_error("incremental re-encode reused a nonce: "+fn);
+    if(run_child({bin+"/decode",qr.string(),out.string()}).status!=0 || !same_file(in,out/"incr.txt")) throw std::runtime_error("round trip mismatch on incremental");
+    fs::remove_all(in); fs::remove_all(qr); fs::remove_all(out);
+  }
+}
+
+// ---------------- Baseline ----------------
+static void write_results(const std::string& path){
+  std::string j="{\n"; bool first=true; char b[256];
+  for(auto& [k,m]:g_results){
+    std::snprintf(b,sizeof(b),"%s  \"%s\": {\"value\": %.4f, \"unit\": \"%s\", \"higherBetter\": %s}",
+                  first?"":",\n",k.c_str(),m.value,m.unit.c_str(),m.higherBetter?"true":"false");
+    j+=b; first=false;
+  }
+  j+="\n}\n"; write_all(path,std::vector<uint8_t>(j.begin(),j.end()));
+}
+// Returns the number of metrics that regressed by more than 5%.
+static int compare(const std::string& path){
+  auto raw=read_all(path); auto base=mini_json::value::parse(std::string(raw.begin(),raw.end()));
+  std::printf("\nvs %s\n  %-34s %12s %12s %8s\n",path.c_str(),"metric","baseline","now","delta");
+  int bad=0;
+  for(auto& [k,m]:g_results){
+    if(!base.contains(k)) continue;
+    double was=base[k]["value"].get<double>(); if(was==0) continue;
+    double pct=(m.value-was)/was*100, worse=m.higherBetter?-pct:pct;
+    bool flag=worse>5; bad+=flag;
+    std::printf("  %-34s %12.2f %12.2f %+7.1f%%%s\n",k.c_str(),was,m.value,pct,flag?"  <-- regression":"");
+  }
+  return bad;
+}
+
+int main(int argc,char** argv){
+  std::string bin="build", json, baseline, only; bool quick=false;
+  for(int a=1;a<argc;a++){
+    std::string s=argv[a];
+    if(s=="--bin" && a+1<argc) bin=argv[++a];
+    else if(s=="--json" && a+1<argc) json=argv[++a];
+    else if(s=="--baseline" && a+1<argc) baseline=argv[++a];
+    else if(s=="--only" && a+1<argc) only=argv[++a];
+    else if(s=="--quick") quick=true;
+    else { std::fprintf(stderr,"Usage: bench_suite [--bin DIR] [--quick] [--only kernels|e2e] [--json OUT] [--baseline IN]\n"); return 2; }
+  }
+  fs::path tmp=fs::temp_directory_path()/("gzqr-bench-"+std::to_string(getpid()));
+  fs::create_directories(tmp);
+  int rc=0;
+  try{
+    if(only.empty() || only=="kernels") bench_kernels(tmp);
+    if(only.empty() || only=="e2e") bench_e2e(tmp,bin,quick);
+    if(!json.empty()){ write_results(json); std::printf("\nresults → %s\n",json.c_str()); }
+    if(!baseline.empty() && compare(baseline)>0) rc=3;
+  }catch(const std::exception& e){ std::fprintf(stderr,"Error: %s\n",e.what()); rc=1; }
+  fs::remove_all(tmp);
+  return rc;
+}
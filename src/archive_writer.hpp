@@ -0,0 +1,93 @@
+#pragma once
+/*
+ * GitZipQR.cpp – streaming archive writer (binary format)
+ *
+ * The encoder core shared by MakeEncode and libgzqr: bytes written here go
+ * through compressor → AES-256-GCM → chunker, and parity (erasure.hpp) is
+ * accumulated one group at a time. Every finished chunk body is handed to
+ * `emit` on the writing thread, data before the parity of its group; the
+ * caller builds and renders the codes (usually on a worker pool). After
+ * finish(), manifest() describes the archive. With a segment size the
+ * compressor and GCM stages are never built; indexed.hpp's segment sealer
+ * takes their place, and segments() locates plaintext for the table of
+ * contents.
+ */
+#include "chunk_format.hpp"
+#include "compress.hpp"
+#include "erasure.hpp"
+#include "indexed.hpp"
+#include "stats.hpp"
+#include "stream.hpp"
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace gzqr {
+
+class archive_writer : public byte_sink {
+public:
+  using emit_fn=std::function<void(uint8_t kind,int index,std::vector<uint8_t> body)>;
+  // segment > 0: indexed archive, sealed in segments of that many plaintext bytes.
+  archive_writer(const compress_opts& comp,parity_opts par,size_t chunkSize,
+                 const std::vector<uint8_t>& key,const std::vector<uint8_t>& nonce,emit_fn emit,size_t segment=0)
+    :emit_(std::move(emit)),par_(par),size_(chunkSize),rs_(par,chunkSize),
+     chunks_(chunkSize,[this](int i,std::vector<uint8_t> c){ chunk(i,std::move(c)); }),
+     chunksStat_(stChunker,chunks_),nonce_(nonce){
+    if(segment){
+      seg_=std::make_unique<indexed::segment_sink>(key,nonce,segment,comp,chunksStat_);
+      segStat_=std::make_unique<stat_sink>(stEncrypt,*seg_);
+      return;
+    }
+    enc_=std::make_unique<gcm_encrypt_sink>(key,nonce,std::vector<uint8_t>{},chunksStat_);
+    encStat_=std::make_unique<stat_sink>(stEncrypt,*enc_);
+    zc_=std::make_unique<compress_sink>(comp,*encStat_);
+    zcStat_=std::make_unique<stat_sink>(stCompress,*zc_);
+  }
+  archive_writer(const archive_writer&)=delete; archive_writer& operator=(const archive_writer&)=delete;
+
+  void write(const uint8_t* p,size_t n)override{ head().write(p,n); }
+  void finish()override{ head().finish(); if(par_.on() && !rs_.empty()) flush_parity(); }
+
+  int chunks()const{ return chunks_.count(); }
+  int parity_codes()const{ return group_*par_.k; }
+  // Ciphertext-level fields; the caller adds salt, key salt, name and ext.
+  chunkfmt::manifest manifest()const{
+    chunkfmt::manifest m;
+    m.cipherSha=chunks_.digest(); m.nonce=nonce_; m.chunkSize=(uint32_t)size_; m.cipherSize=chunks_.bytes(); m.codec=zc_?(uint8_t)zc_->codec():(uint8_t)kCodecNone;
+    if(par_.on()){ m.parityN=(uint16_t)par_.n; m.parityK=(uint16_t)par_.k; }
+    if(seg_){ m.layout=indexed::kLayoutIndexed; m.segment=(uint32_t)seg_->segment(); }
+    return m;
+  }
+  // Indexed archives only (null otherwise).
+  const indexed::segment_sink* segments()const{ return seg_.get(); }
+
+private:
+  byte_sink& head(){ return segStat_?*segStat_:*zcStat_; }
+  void chunk(int i,std::vector<uint8_t> c){
+    if(!par_.on()){ emit_(chunkfmt::kData,i,std::move(c)); return; }
+    { stat_scope sc(stParity,c.size()); rs_.add(i%par_.n,c.data(),c.size()); }
+    emit_(chunkfmt::kData,i,std::move(c));
+    if(i%par_.n==par_.n-1) flush_parity();
+  }
+  void flush_parity(){
+    auto ps=rs_.take();
+    for(int j=0;j<par_.k;j++) emit_(chunkfmt::kParity,group_*par_.k+j,std::move(ps[j]));
+    group_++;
+  }
+
+  emit_fn emit_; parity_opts par_; size_t size_; rs_encoder rs_; int group_=0;
+  chunk_sink chunks_; stat_sink chunksStat_; std::vector<uint8_t> nonce_;
+  // One of: compressor → GCM (segment 0), or the segment sealer.
+  std::unique_ptr<gcm_encrypt_sink> enc_; std::unique_ptr<stat_sink> encStat_; std::unique_ptr<compress_sink> zc_; std::unique_ptr<stat_sink> zcStat_;
+  std::unique_ptr<indexed::segment_sink> seg_; std::unique_ptr<stat_sink> segStat_;
+};
+
+// Manifest code payload for copy #copy; `total` = data chunks.
+inline std::vector<uint8_t> manifest_code(const chunkfmt::manifest& m,int total,int copy=0){
+  auto body=m.serialize();
+  chunkfmt::header h; h.kind=chunkfmt::kManifest; h.index=(uint32_t)copy; h.total=(uint32_t)total;
+  return chunkfmt::build(h,body.data(),body.size());
+}
+
+} // namespace gzqr
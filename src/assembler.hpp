@@ -0,0 +1,459 @@
+#pragma once
+/*
+ * GitZipQR.cpp – decoder core
+ *
+ * Shared by MakeDecode and libgzqr. Code payloads (binary v2 or legacy JSON)
+ * are filed into a stream_assembler, which verifies, decrypts and
+ * decompresses them in order into a file or, for the library, a callback.
+ */
+#include "common.hpp"
+#include "config.hpp"
+#include "chunk_format.hpp"
+#include "cdc.hpp"
+#include "indexed.hpp"
+#include "compress.hpp"
+#include "erasure.hpp"
+#include "qr_reader.hpp"
+#include "sheet.hpp"
+#include "planes.hpp"
+#include "stats.hpp"
+#include "stream.hpp"
+#include "chunk_json.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace gzqr {
+
+// ---------------- Stream assembler ----------------
+// File-level metadata carried by every chunk.
+struct archive_meta {
+  std::string nameBase, metaExt, cipherSha;
+  std::vector<uint8_t> salt, nonce, keySalt;
+  int total=-1, chunkSize=0, codec=kCodecNone;
+  uint64_t cipherSize=0; int parityN=0, parityK=0, layout=0;
+  uint32_t segment=0;              // indexed archives (indexed.hpp)
+};
+
+// scrypt results by salt. A batch shares one salt (per-archive keys come
+// from HKDF), so it pays for scrypt once. Derivations are serialised, so
+// archives that need the same salt wait for the first instead of repeating it.
+class key_cache {
+public:
+  explicit key_cache(std::string pass):pass_(std::move(pass)){}
+  std::vector<uint8_t> key(const archive_meta& m){
+    std::vector<uint8_t> k;
+    {
+      std::lock_guard<std::mutex> lk(m_);
+      auto it=keys_.find(m.salt);
+      if(it!=keys_.end()) k=it->second;
+      else{ stat_scope sc(stKdf); k=keys_[m.salt]=scrypt_kdf(pass_,m.salt,{(1u<<15),8u,(uint32_t)std::max(1u,std::thread::hardware_concurrency())}); }
+    }
+    if(!m.keySalt.empty()) k=hkdf_sha256(k,m.keySalt,std::string(gzqr_config::kProjectName)+" archive key");
+    return k;
+  }
+private: std::string pass_; std::mutex m_; std::map<std::vector<uint8_t>,std::vector<uint8_t>> keys_;
+};
+
+// Restored bytes, in file order (library output instead of a file).
+using data_fn=std::function<void(const uint8_t*,size_t)>;
+
+/*
+ * Incremental archive (manifest layout 1): the recipe gives every block its
+ * offsets, so blocks are opened and written with pwrite in whatever order
+ * their codes complete. Blocks completed before the recipe wait for it.
+ * Without a path the file is built in memory and handed to `onData` on finish.
+ */
+class cdc_assembler {
+public:
+  cdc_assembler(const std::string& path,data_fn onData,const std::vector<uint8_t>& key,const archive_meta& m)
+    :keys_(cdc::derive_keys(key,m.salt)),meta_(m),onData_(std::move(onData)){
+    if(onData_) return;
+    fd_=::open(path.c_str(),O_WRONLY|O_CREAT|O_TRUNC,0644);
+    if(fd_<0) throw std::runtime_error("open out");
+  }
+  ~cdc_assembler(){ if(fd_>=0) ::close(fd_); }
+
+  // Part of a 'B' (body = id + slice) or 'R' code; first copy wins.
+  void put(uint8_t kind,int part,int parts,std::vector<uint8_t> body){
+    std::vector<std::pair<cdc::block_id,std::vector<uint8_t>>> ready; std::vector<uint8_t> recipe;
+    {
+      std::lock_guard<std::mutex> lk(m_);
+      if(kind==chunkfmt::kRecipe){
+        if(parts!=meta_.total || !add(recipe_,part,parts,std::move(body))) return;
+        recipe=join(recipe_);
+      } else {
+        if(body.size()<cdc::kIdSize) return;
+        cdc::block_id id; std::copy(body.begin(),body.begin()+cdc::kIdSize,id.begin());
+        if(done_.count(id) || (haveRecipe_ && !where_.count(id))) return;   // written, or not ours
+        body.erase(body.begin(),body.begin()+cdc::kIdSize);
+        auto& b=blocks_[id];
+        if(!add(b,part,parts,std::move(body)) || !haveRecipe_) return;
+        ready.emplace_back(id,join(b)); blocks_.erase(id); done_.insert(id);
+      }
+    }
+    if(!recipe.empty()) ready=open_recipe(recipe);
+    for(auto& [id,sealed]:ready) write_block(id,sealed);
+  }
+  void finish(){
+    std::lock_guard<std::mutex> lk(m_);
+    if(!haveRecipe_) throw std::runtime_error("Missing recipe codes");
+    if(done_.size()<where_.size()) throw std::runtime_error("Missing blocks: "+std::to_string(where_.size()-done_.size())+" of "+std::to_string(where_.size()));
+    if(onData_){ stat_scope sc(stOutput,mem_.size()); onData_(mem_.data(),mem_.size()); return; }
+    if(::close(fd_)!=0){ fd_=-1; throw std::runtime_error("write out"); }
+    fd_=-1;
+  }
+  int blocks()const{ return (int)where_.size(); }
+
+private:
+  struct parts { std::vector<std::vector<uint8_t>> v; int have=0; };
+  static bool add(parts& p,int part,int n,std::vector<uint8_t> d){
+    if(p.v.empty()) p.v.resize((size_t)n);
+    if(n<1 || (int)p.v.size()!=n || part<0 || part>=n || !p.v[part].empty() || d.empty()) return false;
+    p.v[part]=std::move(d); return ++p.have==n;
+  }
+  static std::vector<uint8_t> join(const parts& p){
+    std::vector<uint8_t> o; for(auto& s:p.v) o.insert(o.end(),s.begin(),s.end()); return o;
+  }
+  // Verifies and opens the recipe, sizes the file and hands back the blocks already complete.
+  std::vector<std::pair<cdc::block_id,std::vector<uint8_t>>> open_recipe(const std::vector<uint8_t>& sealed){
+    unsigned char d[32]; SHA256(sealed.data(),sealed.size(),d);
+    if(hex(d,32)!=meta_.cipherSha || (meta_.cipherSize && sealed.size()!=meta_.cipherSize)) throw std::runtime_error("Global sha256 mismatch");
+    vector_sink plain;
+    try{ stat_scope sc(stDecrypt,sealed.size()); gcm_decrypt_sink dec(keys_.enc,meta_.nonce,cdc::recipe_aad(),plain); dec.write(sealed.data(),sealed.size()); dec.finish(); }
+    catch(const std::exception& e){ throw std::runtime_error(std::string("Decrypt failed (wrong password or damaged codes): ")+e.what()); }
+    std::map<cdc::block_id,spot> where; uint64_t off=0;
+    for(auto& e:cdc::parse_recipe(plain.data)){ auto& w=where[e.id]; w.size=e.size; w.offs.push_back(off); off+=e.size; }
+    if(onData_) mem_.resize(off);
+    else if(::ftruncate(fd_,(off_t)off)!=0) throw std::runtime_error("write out");
+    std::vector<std::pair<cdc::block_id,std::vector<uint8_t>>> ready;
+    std::lock_guard<std::mutex> lk(m_);
+    where_=std::move(where); haveRecipe_=true;
+    for(auto it=blocks_.begin();it!=blocks_.end();){
+      if(it->second.have==(int)it->second.v.size() && where_.count(it->first)){ ready.emplace_back(it->first,join(it->second)); done_.insert(it->first); }
+      if(it->second.have==(int)it->second.v.size() || !where_.count(it->first)) it=blocks_.erase(it); else ++it;
+    }
+    return ready;
+  }
+  void write_block(const cdc::block_id& id,const std::vector<uint8_t>& sealed){
+    std::vector<uint8_t> plain;
+    try{ stat_scope sc(stDecrypt,sealed.size(),true); plain=cdc::open_block(keys_,id,sealed); }
+    catch(const std::exception& e){ throw std::runtime_error(std::string("Decrypt failed (wrong password or damaged codes): ")+e.what()); }
+    const spot& w=where_.at(id);   // fixed once the recipe is in
+    if(plain.size()!=w.size) throw std::runtime_error("Block size mismatch");
+    stat_scope sc(stOutput,plain.size()*w.offs.size());
+    if(onData_){ for(uint64_t off:w.offs) std::memcpy(mem_.data()+off,plain.data(),plain.size()); return; }   // disjoint ranges
+    for(uint64_t off:w.offs)
+      for(size_t k=0;k<plain.size();){
+        ssize_t r=::pwrite(fd_,plain.data()+k,plain.size()-k,(off_t)(off+k));
+        if(r<=0) throw std::runtime_error("write out");
+        k+=(size_t)r;
+      }
+  }
+
+  struct spot { uint32_t size=0; std::vector<uint64_t> offs; };
+  cdc::block_keys keys_; archive_meta meta_; int fd_=-1;
+  data_fn onData_; std::vector<uint8_t> mem_;
+  std::mutex m_; parts recipe_; bool haveRecipe_=false;
+  std::map<cdc::block_id,parts> blocks_; std::set<cdc::block_id> done_; std::map<cdc::block_id,spot> where_;
+};
+
+/*
+ * Shared by the scan workers. The first metadata offered (manifest codes are
+ * scanned first) fixes the archive; its key is derived right away and the
+ * output chain SHA-256 → AES-GCM → decompressor → file is opened. Chunks are
+ * then fed in index order as they arrive. Only chunks ahead of a gap are held
+ * in memory. Whichever worker supplies the next chunk drains the run, and the
+ * others just hand theirs over. No temporary file, one pass. The GCM tag is
+ * the tail of the last chunk.
+ *
+ * With parity, the drainer keeps the current group's chunks and, when the
+ * next chunk is missing but N codes of its group are in, rebuilds it
+ * (erasure.hpp). Parity of groups already written is dropped. Manifest codes
+ * aren't covered; only their copies protect them.
+ *
+ * Incremental archives go to a cdc_assembler; their block and recipe codes
+ * are held until the manifest is in. Indexed archives stream the same way,
+ * with segment records opened one by one in place of the single GCM stream;
+ * their table-of-contents codes are only for --extract and are skipped.
+ */
+class stream_assembler {
+public:
+  stream_assembler(std::string outdir,key_cache& keys):outdir_(std::move(outdir)),keys_(keys){}
+  // Library: restored bytes go to `onData` (from the thread that drains).
+  stream_assembler(data_fn onData,key_cache& keys):keys_(keys),onData_(std::move(onData)){}
+  ~stream_assembler(){ if(!done_) discard(); }
+
+  // True once some code's metadata was accepted; later offers are ignored.
+  bool meta_claimed(){ std::lock_guard<std::mutex> lk(m_); return claimed_; }
+  // v1 JSON codes each repeat the archive fields (`fields`, concatenated).
+  // Codes that disagree with the first one make the scan fail, so which
+  // code supplies the metadata can't change the result.
+  void check_fields(const std::string& fields){
+    std::lock_guard<std::mutex> lk(m_);
+    if(fields_.empty()) fields_=fields;
+    else if(fields!=fields_) throw std::runtime_error("Codes from more than one archive (archive fields differ)");
+  }
+  // False for a code that would be dropped anyway (a repeat, or a chunk
+  // already written), so callers can skip it right after its header.
+  bool wants(uint8_t kind,int index){
+    std::lock_guard<std::mutex> lk(m_);
+    switch(kind){
+      case chunkfmt::kManifest: return !claimed_;
+      case chunkfmt::kData:     return index>=next_ && !pending_.count(index) && !(ready_ && !cdc_ && index>=meta_.total);
+      case chunkfmt::kParity:   return !parity_.count(index) && !(ready_ && !cdc_ && (!meta_.parityK || group_done(index/meta_.parityK)));
+      case chunkfmt::kIndex:    return false;   // --extract only
+      default:                  return true;
+    }
+  }
+  // Every data chunk has been written (incremental archives: never; they
+  // are read to the end).
+  bool complete(){ std::lock_guard<std::mutex> lk(m_); return ready_ && !cdc_ && next_==meta_.total; }
+  void offer_meta(archive_meta meta){
+    { std::lock_guard<std::mutex> lk(m_); if(claimed_) return; claimed_=true; }
+    if(meta.codec<0) throw std::runtime_error("Unknown compression codec");
+    if(meta.parityK && (meta.parityN<1 || meta.parityN+meta.parityK>256)) throw std::runtime_error("Bad parity parameters");
+    std::vector<uint8_t> key;
+    key=keys_.key(meta);
+    std::string outName=(meta.nameBase.empty()?std::string("restored"):meta.nameBase)+meta.metaExt;
+    if(meta.layout==cdc::kLayoutCdc){
+      std::vector<early_part> early;
+      {
+        std::lock_guard<std::mutex> lk(m_);
+        if(!onData_) outPath_=(std::filesystem::path(outdir_)/outName).string();
+        cdc_=std::make_unique<cdc_assembler>(outPath_,onData_,key,meta);
+        meta_=std::move(meta); ready_=true; early.swap(early_);
+      }
+      for(auto& e:early) cdc_->put(e.kind,e.part,e.parts,std::move(e.body));
+      return;
+    }
+    const bool segmented=meta.layout==indexed::kLayoutIndexed;
+    if(meta.layout && !segmented) throw std::runtime_error("Unknown archive layout");
+    if(segmented && (meta.segment<1 || meta.segment>(1u<<30))) throw std::runtime_error("Bad segment size");
+    {
+      std::lock_guard<std::mutex> lk(m_);
+      if(onData_) out_=std::make_unique<callback_sink>(onData_);
+      else{ outPath_=(std::filesystem::path(outdir_)/outName).string(); out_=std::make_unique<file_sink>(outPath_); }
+      outStat_=std::make_unique<stat_sink>(stOutput,*out_);
+      if(segmented) dec_=std::make_unique<indexed::segment_open_sink>(key,meta.nonce,meta.segment,*outStat_);
+      else{
+        unz_=make_decompressor(meta.codec,*outStat_);
+        unzStat_=std::make_unique<stat_sink>(stDecompress,*unz_);
+        dec_=std::make_unique<gcm_decrypt_sink>(key,meta.nonce,std::vector<uint8_t>{},*unzStat_);
+      }
+      meta_=std::move(meta); ready_=true;
+    }
+    drain();
+  }
+  // First verified copy of a chunk wins; later duplicates are dropped.
+  void put(int chunk,std::vector<uint8_t> data){
+    {
+      std::lock_guard<std::mutex> lk(m_);
+      if(chunk<next_ || (ready_ && meta_.total>=0 && chunk>=meta_.total)) return;
+      pending_.emplace(chunk,std::move(data));
+    }
+    drain();
+  }
+  // Parity code #idx (group*K + row).
+  void put_parity(int idx,std::vector<uint8_t> data){
+    {
+      std::lock_guard<std::mutex> lk(m_);
+      if(ready_ && (!meta_.parityK || group_done(idx/meta_.parityK))) return;
+      parity_.emplace(idx,std::move(data));
+    }
+    drain();
+  }
+  // Block or recipe part of an incremental archive.
+  void put_cdc(uint8_t kind,int part,int parts,std::vector<uint8_t> body){
+    {
+      std::lock_guard<std::mutex> lk(m_);
+      if(!ready_){ early_.push_back({kind,part,parts,std::move(body)}); return; }
+    }
+    if(cdc_) cdc_->put(kind,part,parts,std::move(body));
+  }
+  // After all scans: checks completeness and the global hash, then verifies the tag.
+  void finish(){
+    if(!ready_) throw std::runtime_error("No archive metadata (every manifest copy missing? parity doesn't cover them)");
+    if(cdc_){ cdc_->finish(); done_=true; return; }
+    if(next_!=meta_.total){
+      if(!meta_.parityK) throw std::runtime_error("Missing chunks");
+      throw std::runtime_error("Missing chunks: group "+std::to_string(next_/meta_.parityN)+" lost more than "+std::to_string(meta_.parityK)+" codes");
+    }
+    if(hex(sha_.final().data(),32)!=meta_.cipherSha) throw std::runtime_error("Global sha256 mismatch");
+    try{ stat_scope sc(stDecrypt); dec_->finish(); }catch(const std::exception& e){ throw std::runtime_error(std::string("Decrypt failed (wrong password or damaged codes): ")+e.what()); }
+    done_=true;
+  }
+  const archive_meta& meta()const{ return meta_; }
+  const std::string& out_path()const{ return outPath_; }
+  int rebuilt()const{ return rebuilt_; }
+  int blocks()const{ return cdc_?cdc_->blocks():0; }
+
+private:
+  void drain(){
+    std::unique_lock<std::mutex> lk(m_);
+    if(!ready_ || draining_) return;
+    draining_=true;
+    for(;;){
+      auto it=pending_.find(next_);
+      if(it==pending_.end()){ if(next_<meta_.total && rebuild(lk)) continue; break; }
+      std::vector<uint8_t> d=std::move(it->second); pending_.erase(it); int c=next_++;
+      lk.unlock();
+      try{ stat_scope sc(stDecrypt,d.size()); sha_.update(d.data(),d.size()); dec_->write(d.data(),d.size()); }
+      catch(const std::exception& e){ throw std::runtime_error(std::string("Decrypt failed (wrong password or damaged codes): ")+e.what()); } // draining_ stays set: the chain is dead
+      lk.lock();
+      if(meta_.parityK) keep(c,std::move(d));
+    }
+    draining_=false;
+  }
+  bool group_done(int g)const{ return next_>=std::min((g+1)*meta_.parityN,meta_.total); }
+  // Holds on to the written chunks of the current group for rebuilds.
+  void keep(int c,std::vector<uint8_t> d){
+    int g=c/meta_.parityN;
+    if(g!=group_){
+      group_=g; groupData_.clear();
+      parity_.erase(parity_.begin(),parity_.lower_bound(g*meta_.parityK));
+    }
+    groupData_[c%meta_.parityN]=std::move(d);
+  }
+  // next_ is missing: rebuilds its group if enough codes are in. Called by
+  // the drainer, so nothing it points into is erased meanwhile.
+  bool rebuild(std::unique_lock<std::mutex>& lk){
+    const int N=meta_.parityN, K=meta_.parityK; if(!K) return false;
+    const int g=next_/N, first=g*N, n=std::min(N,meta_.total-first);
+    std::vector<rs_piece> pieces; std::vector<int> missing;
+    for(int c=0;c<n;c++){
+      if(group_==g){ auto it=groupData_.find(c); if(it!=groupData_.end()){ pieces.push_back({c,&it->second}); continue; } }
+      auto it=pending_.find(first+c);
+      if(it!=pending_.end()) pieces.push_back({c,&it->second}); else missing.push_back(c);
+    }
+    for(int j=0;j<K && (int)pieces.size()<n;j++){
+      auto it=parity_.find(g*K+j); if(it!=parity_.end()) pieces.push_back({N+j,&it->second});
+    }
+    if((int)pieces.size()<n) return false;
+    lk.unlock();
+    std::vector<std::vector<uint8_t>> out;
+    try{ stat_scope sc(stParity,(uint64_t)n*meta_.chunkSize); out=rs_rebuild(N,n,(size_t)meta_.chunkSize,pieces,missing); }
+    catch(...){ lk.lock(); throw; }
+    lk.lock();
+    for(size_t k=0;k<missing.size();k++){
+      int chunk=first+missing[k];
+      if(chunk==meta_.total-1 && meta_.cipherSize) out[k].resize((size_t)(meta_.cipherSize-(uint64_t)chunk*meta_.chunkSize));
+      if(pending_.emplace(chunk,std::move(out[k])).second) rebuilt_++;
+    }
+    return true;
+  }
+  void discard(){
+    dec_.reset(); unzStat_.reset(); unz_.reset(); outStat_.reset(); out_.reset(); cdc_.reset();
+    if(!outPath_.empty()) std::filesystem::remove(outPath_);
+  }
+
+  std::string outdir_, outPath_; key_cache& keys_; data_fn onData_;
+  std::mutex m_;
+  archive_meta meta_; bool claimed_=false, ready_=false, draining_=false, done_=false;
+  std::string fields_;
+  std::map<int,std::vector<uint8_t>> pending_; int next_=0;
+  std::map<int,std::vector<uint8_t>> parity_, groupData_; int group_=-1, rebuilt_=0;
+  sha256_stream sha_;
+  struct early_part { uint8_t kind; int part, parts; std::vector<uint8_t> body; };
+  std::vector<early_part> early_; std::unique_ptr<cdc_assembler> cdc_;
+  std::unique_ptr<byte_sink> out_, outStat_, unz_, unzStat_, dec_;
+};
+
+// Per-chunk progress; quiet when outMu is null (batch runs).
+inline void progress(std::mutex* outMu,int chunk,int total){
+  if(!outMu || !gzqr_config::kPrintProgressCounters) return;
+  std::lock_guard<std::mutex> lk(*outMu);
+  if(total>0) std::fprintf(stdout,"   collected chunk %d/%d\n",chunk+1,total);
+  else std::fprintf(stdout,"   collected chunk %d\n",chunk+1);
+}
+
+// v2 binary code: data chunk, manifest, parity, or incremental block/recipe part.
+inline void scan_binary(std::string_view raw,stream_assembler& table,std::mutex* outMu){
+  chunkfmt::chunk_view cv; const uint8_t* p=(const uint8_t*)raw.data();
+  if(!chunkfmt::parse_header(p,raw.size(),cv) || !table.wants(cv.h.kind,(int)cv.h.index) || !chunkfmt::body_ok(p,cv)) return;
+  if(cv.h.kind==chunkfmt::kManifest){
+    auto m=chunkfmt::manifest::parse(cv.body,cv.size);
+    archive_meta a;
+    a.total=(int)cv.h.total; a.chunkSize=(int)m.chunkSize;
+    a.cipherSha=hex(m.cipherSha.data(),m.cipherSha.size());
+    a.salt=m.salt; a.nonce=m.nonce;
+    a.nameBase=m.name.empty()?"restored":m.name; a.metaExt=m.ext; a.codec=m.codec;
+    a.keySalt=m.keySalt; a.cipherSize=m.cipherSize; a.parityN=m.parityN; a.parityK=m.parityK; a.layout=m.layout; a.segment=m.segment;
+    table.offer_meta(std::move(a));
+    return;
+  }
+  if(cv.h.kind==chunkfmt::kBlock || cv.h.kind==chunkfmt::kRecipe){ table.put_cdc(cv.h.kind,(int)cv.h.index,(int)cv.h.total,std::vector<uint8_t>(cv.body,cv.body+cv.size)); return; }
+  if(cv.h.kind==chunkfmt::kParity){ table.put_parity((int)cv.h.index,std::vector<uint8_t>(cv.body,cv.body+cv.size)); return; }
+  if(cv.h.kind!=chunkfmt::kData) return;
+  table.put((int)cv.h.index,std::vector<uint8_t>(cv.body,cv.body+cv.size));
+  progress(outMu,(int)cv.h.index,(int)cv.h.total);
+}
+
+// One code payload: if it is a valid code of ours, files it in the table.
+inline void scan_payload(std::string_view txt,stream_assembler& table,std::mutex* outMu){
+  if(chunkfmt::is_binary((const uint8_t*)txt.data(),txt.size())) return scan_binary(txt,table,outMu);
+  stat_scope sc(stJsonParse,txt.size(),true);
+  static const std::string type=std::string(gzqr_config::kProjectName)+"-CHUNK-ENC";
+  using chunkjson::view;
+  view j; chunkjson::parse(txt,j);
+  if(!j.has(view::fType) || !chunkjson::equals(j.type,type)) return;
+  if((j.seen&view::kRequired)!=view::kRequired) throw std::runtime_error("JSON code with missing fields");
+
+  int chunk=(int)j.chunk, total=(int)j.total;
+  { std::string f; f.reserve(256);
+    for(std::string_view v:{j.cipherHash,j.saltB64,j.nonceB64,j.keySaltB64,j.name,j.ext,j.codec}){ f.append(v); f+='\0'; }
+    f+=std::to_string(total)+':'+std::to_string((long long)j.chunkSize);
+    table.check_fields(f); }
+  if(!table.wants(chunkfmt::kData,chunk)) return;
+  std::vector<uint8_t> data(text::b64_decoded_max(j.dataB64.size()));
+  data.resize(text::b64_decode(j.dataB64.data(),j.dataB64.size(),data.data()));
+  { unsigned char h[32]; char hx[64]; SHA256(data.data(),data.size(),h); text::hex_encode(h,32,hx);
+    if(!chunkjson::equals(j.hash,std::string_view(hx,64))) return; }
+
+  sc.stop();
+
+  // Archive fields repeat in every code and were checked to agree; the first is used.
+  if(!table.meta_claimed()){
+    auto b64v=[](std::string_view s){ std::vector<uint8_t> o(text::b64_decoded_max(s.size())); o.resize(text::b64_decode(s.data(),s.size(),o.data())); return o; };
+    archive_meta m;
+    m.total=total;
+    m.chunkSize=(int)j.chunkSize;
+    m.cipherSha=chunkjson::unescape(j.cipherHash);
+    m.salt=b64v(j.saltB64);
+    m.nonce=b64v(j.nonceB64);
+    if(j.has(view::fKeySalt)) m.keySalt=b64v(j.keySaltB64);
+    m.nameBase=j.has(view::fName)?chunkjson::unescape(j.name):"restored";
+    if(j.has(view::fExt)) m.metaExt=chunkjson::unescape(j.ext);
+    if(j.has(view::fCodec) && !codec_from_name(chunkjson::unescape(j.codec),m.codec)) m.codec=-1;
+    table.offer_meta(std::move(m));
+  }
+  table.put(chunk,std::move(data));
+  progress(outMu,chunk,total);
+}
+
+// Every code in one decoded image (a single code, a sheet, or one code per
+// colour plane).
+inline void scan_image(const raster& r,stream_assembler& table,std::mutex* outMu){
+  std::vector<std::string> codes;
+  { stat_scope sc(stQrDecode,0,true);
+    if(is_colour(r)){
+      raster plane;
+      for(int c=0;c<kPlanes;c++) if(split_plane(r,c,plane)) for(auto& t:read_codes(plane)) codes.push_back(std::move(t));
+    } else codes=read_codes(r);
+    for(auto& t:codes) sc.add_bytes(t.size()); }
+  for(auto& t:codes) if(!t.empty()) scan_payload(t,table,outMu);
+}
+
+} // namespace gzqr
@@ -0,0 +1,195 @@
+#pragma once
+/*
+ * GitZipQR.cpp – incremental archives (content-defined chunking)
+ *
+ * --incremental cuts the plaintext with a gear rolling hash into blocks of
+ * 4–64 KiB (about 16 KiB on average). Cut points depend only on the last 64
+ * bytes, so an edit moves at most the block boundaries around it. Each block
+ * is compressed and sealed on its own with AES-256-GCM:
+ *
+ *   id     = HMAC-SHA256(idKey, plaintext)[0..16)            names the block, GCM AAD
+ *   sealed = nonce + GCM(codec byte + compressed block) + tag
+ *   nonce  = HMAC-SHA256(nonceKey, codec byte + compressed block)[0..12)
+ *
+ * The nonce depends on the exact bytes encrypted, not just the plaintext:
+ * the salt (and so the key) carries over between runs, and a block resealed
+ * with another --compress setting, level or zlib build gets other bytes, so
+ * it must never get the same nonce. The same content compressed the same way
+ * still gives the same ciphertext and the same codes. Identical blocks are
+ * recognisable as such; nothing else leaks. A block's codes are
+ * qr-b<id>-<part>.png ('B' chunks, body = id + slice).
+ *
+ * The recipe lists (id, plain size) in file order. It is sealed with a fresh
+ * nonce every run, written as 'R' chunks and described by the manifest. The
+ * index file next to the codes keeps the scrypt salt (so the key stays the
+ * same across runs) and the blocks that already have codes. A re-encode
+ * renders only new blocks and deletes the codes of blocks nothing refers to.
+ */
+#include "common.hpp"
+#include "stream.hpp"
+#include "compress.hpp"
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+#include <openssl/hmac.h>
+
+namespace gzqr::cdc {
+
+inline constexpr size_t kMin = 4<<10, kAvg = 16<<10, kMax = 64<<10;
+inline constexpr size_t kIdSize = 16, kNonceSize = 12;
+inline constexpr uint8_t kLayoutCdc = 1;                 // manifest tLayout value
+// Normalised chunking: a stricter mask below the average size and a looser
+// one above, which narrows the size spread. The high bits see the last 64 bytes.
+inline constexpr uint64_t kMaskS = ~0ull << (64-16), kMaskL = ~0ull << (64-12);
+
+struct gear_table {
+  uint64_t v[256];
+  gear_table(){ uint64_t x=0; for(auto& g:v){ x+=0x9E3779B97F4A7C15ull; uint64_t z=x; z=(z^(z>>30))*0xBF58476D1CE4E5B9ull; z=(z^(z>>27))*0x94D049BB133111EBull; g=z^(z>>31); } }
+};
+inline const uint64_t* gear(){ static const gear_table t; return t.v; }
+
+// Cuts the stream into content-defined blocks and hands each to `emit`.
+class cdc_sink : public byte_sink {
+public:
+  using emit_fn=std::function<void(std::vector<uint8_t>)>;
+  explicit cdc_sink(emit_fn emit):emit_(std::move(emit)){ cur_.reserve(kMax); }
+  void write(const uint8_t* p,size_t n)override{
+    const uint64_t* g=gear();
+    while(n>0){
+      size_t len=cur_.size(), take=std::min(n,kMax-len), k=0; bool cut=false;
+      for(;k<take;k++){
+        h_=(h_<<1)+g[p[k]];
+        size_t l=len+k+1;
+        if(l>=kMin && !(h_&(l<kAvg?kMaskS:kMaskL))){ k++; cut=true; break; }
+      }
+      cur_.insert(cur_.end(),p,p+k); p+=k; n-=k;
+      if(cut || cur_.size()==kMax) flush();
+    }
+  }
+  void finish()override{ if(!cur_.empty()) flush(); }
+private:
+  void flush(){ std::vector<uint8_t> b; b.reserve(kMax); b.swap(cur_); h_=0; emit_(std::move(b)); }
+  emit_fn emit_; std::vector<uint8_t> cur_; uint64_t h_=0;
+};
+
+// ---------------- Keys ----------------
+struct block_keys { std::vector<uint8_t> enc, id, nonce; };
+inline block_keys derive_keys(const std::vector<uint8_t>& key,const std::vector<uint8_t>& salt){
+  return { hkdf_sha256(key,salt,"gzqr cdc block key"), hkdf_sha256(key,salt,"gzqr cdc block id"), hkdf_sha256(key,salt,"gzqr cdc block nonce") };
+}
+inline std::array<uint8_t,32> hmac_of(const std::vector<uint8_t>& key,const uint8_t* p,size_t n){
+  std::array<uint8_t,32> mac; unsigned int len=0;
+  if(!HMAC(EVP_sha256(),key.data(),(int)key.size(),p,n,mac.data(),&len)) throw std::runtime_error("hmac");
+  return mac;
+}
+using block_id=std::array<uint8_t,kIdSize>;
+inline block_id content_id(const block_keys& k,const uint8_t* p,size_t n){
+  auto mac=hmac_of(k.id,p,n); block_id id; std::copy(mac.begin(),mac.begin()+kIdSize,id.begin()); return id;
+}
+// Nonce for sealing `body` (codec byte + compressed block).
+inline std::vector<uint8_t> nonce_of(const block_keys& k,const std::vector<uint8_t>& body){
+  auto mac=hmac_of(k.nonce,body.data(),body.size()); return std::vector<uint8_t>(mac.begin(),mac.begin()+kNonceSize);
+}
+inline std::vector<uint8_t> aad_of(const block_id& id){ return std::vector<uint8_t>(id.begin(),id.end()); }
+inline const std::vector<uint8_t>& recipe_aad(){ static const std::vector<uint8_t> a{'r','e','c','i','p','e'}; return a; }
+// Short tag that tells whether an index was written under the same password.
+inline std::string key_check(const std::vector<uint8_t>& key,const std::vector<uint8_t>& salt){
+  auto c=hkdf_sha256(key,salt,"gzqr cdc index check"); return hex(c.data(),8);
+}
+
+// ---------------- Blocks ----------------
+// Sealed block = nonce + GCM(codec byte + compressed plaintext). "auto" means deflate
+// here: xz's per-stream setup costs more than it saves on 16 KiB. Any codec
+// that doesn't shrink the block falls back to storing it.
+inline std::vector<uint8_t> seal_block(const block_keys& k,const block_id& id,const std::vector<uint8_t>& plain,const compress_opts& o){
+  int codec=o.autoSelect?kCodecDeflate:o.codec;
+  vector_sink z; z.data.push_back((uint8_t)codec);
+  { auto c=make_compressor(codec,o.autoSelect?-1:o.level,z); c->write(plain.data(),plain.size()); c->finish(); }
+  if(codec!=kCodecNone && z.data.size()>plain.size()){ z.data.assign(1,(uint8_t)kCodecNone); z.data.insert(z.data.end(),plain.begin(),plain.end()); }
+  const auto nonce=nonce_of(k,z.data);
+  vector_sink c; c.data=nonce;
+  { gcm_encrypt_sink e(k.enc,nonce,aad_of(id),c); e.write(z.data.data(),z.data.size()); e.finish(); }
+  return std::move(c.data);
+}
+// Inverse of seal_block; also checks that the plaintext really has this id.
+inline std::vector<uint8_t> open_block(const block_keys& k,const block_id& id,const std::vector<uint8_t>& cipher){
+  if(cipher.size()<kNonceSize) throw std::runtime_error("block truncated");
+  vector_sink body;
+  { gcm_decrypt_sink d(k.enc,std::vector<uint8_t>(cipher.begin(),cipher.begin()+kNonceSize),aad_of(id),body);
+    d.write(cipher.data()+kNonceSize,cipher.size()-kNonceSize); d.finish(); }
+  if(body.data.empty()) throw std::runtime_error("empty block");
+  vector_sink out;
+  { auto u=make_decompressor(body.data[0],out); u->write(body.data.data()+1,body.data.size()-1); u->finish(); }
+  if(content_id(k,out.data.data(),out.data.size())!=id) throw std::runtime_error("block id mismatch");
+  return std::move(out.data);
+}
+
+// ---------------- Recipe ----------------
+struct recipe_entry { block_id id; uint32_t size; };
+inline std::vector<uint8_t> recipe_bytes(const std::vector<recipe_entry>& r){
+  std::vector<uint8_t> o; o.reserve(r.size()*(kIdSize+4));
+  for(auto& e:r){ o.insert(o.end(),e.id.begin(),e.id.end()); for(int i=0;i<4;i++) o.push_back((e.size>>(8*i))&255); }
+  return o;
+}
+inline std::vector<recipe_entry> parse_recipe(const std::vector<uint8_t>& b){
+  if(b.size()%(kIdSize+4)) throw std::runtime_error("recipe truncated");
+  std::vector<recipe_entry> r(b.size()/(kIdSize+4));
+  for(size_t i=0;i<r.size();i++){
+    const uint8_t* p=&b[i*(kIdSize+4)];
+    std::copy(p,p+kIdSize,r[i].id.begin());
+    r[i].size=(uint32_t)p[16]|((uint32_t)p[17]<<8)|((uint32_t)p[18]<<16)|((uint32_t)p[19]<<24);
+  }
+  return r;
+}
+
+inline std::string block_png(const std::string& idHex,int part){ return "qr-b"+idHex+"-"+std::to_string(part)+".png"; }
+
+// ---------------- Index ----------------
+/*
+ * gzqr-index.txt, one record per line:
+ *   gzqr-index 2
+ *   salt <b64> | check <hex> | chunk <bytes per code> | recipe <codes>
+ *   b <id hex> <codes> <plain size>
+ */
+struct block_index {
+  static constexpr const char* kFile = "gzqr-index.txt";
+  struct entry { int parts=0; uint32_t size=0; };
+  std::vector<uint8_t> salt; std::string check;
+  int chunkSize=0, recipeParts=0;
+  std::map<std::string,entry> blocks;
+
+  bool load(const std::string& dir){
+    FILE* f=fopen((std::filesystem::path(dir)/kFile).c_str(),"rb"); if(!f) return false;
+    char line[512]; bool ok=fgets(line,sizeof(line),f);
+    if(ok && std::string(line).rfind("gzqr-index 1",0)==0){ fclose(f); throw std::runtime_error(std::string(kFile)+" is from an older format; remove it and the qr-b*.png codes to start over"); }
+    ok=ok && std::string(line).rfind("gzqr-index 2",0)==0;
+    while(ok && fgets(line,sizeof(line),f)){
+      char k[16], v[256]; int parts=0; unsigned size=0;
+      if(std::sscanf(line,"b %255s %d %u",v,&parts,&size)==3) blocks[v]=entry{parts,size};
+      else if(std::sscanf(line,"%15s %255s",k,v)==2){
+        std::string key=k;
+        if(key=="salt") salt=b64d(v); else if(key=="check") check=v;
+        else if(key=="chunk") chunkSize=std::atoi(v); else if(key=="recipe") recipeParts=std::atoi(v);
+      }
+    }
+    fclose(f);
+    if(!ok) throw std::runtime_error(std::string("not a ")+kFile);
+    return true;
+  }
+  // Written next to the codes via a temp file, so a crash never leaves half an index.
+  void save(const std::string& dir)const{
+    auto path=std::filesystem::path(dir)/kFile, tmp=path; tmp+=".tmp";
+    { file_sink f(tmp.string()); std::string s="gzqr-index 2\nsalt "+b64(salt)+"\ncheck "+check+"\nchunk "+std::to_string(chunkSize)+"\nrecipe "+std::to_string(recipeParts)+"\n";
+      for(auto& [id,e]:blocks) s+="b "+id+" "+std::to_string(e.parts)+" "+std::to_string(e.size)+"\n";
+      f.write((const uint8_t*)s.data(),s.size()); f.finish(); }
+    std::filesystem::rename(tmp,path);
+  }
+};
+
+} // namespace gzqr::cdc
@@ -0,0 +1,146 @@
+#pragma once
+/*
+ * GitZipQR.cpp – binary chunk format (v2)
+ *
+ * Every code is raw bytes in QR byte mode:
+ *
+ *   off size field
+ *     0   3  magic "GZQ"
+ *     3   1  format version (2)
+ *     4   1  kind: 'D' data chunk, 'M' manifest, 'S' sheet index, 'P' parity,
+ *              'B' block part, 'R' recipe part (incremental archives, cdc.hpp),
+ *              'I' table-of-contents part (indexed archives, indexed.hpp)
+ *     5   1  flags: bits 0-1 = colour plane + 1 for --rgb codes (planes.hpp),
+ *              else 0; other bits reserved
+ *     6   4  index (u32 LE)       data: chunk index, manifest: copy no, sheet: sheet no,
+ *                                 parity: group*K + row (see erasure.hpp),
+ *                                 block/recipe/toc: part no
+ *    10   4  total (u32 LE)       number of data chunks; 0 in data codes
+ *                                 written while streaming (manifest is
+ *                                 authoritative); block/recipe/toc: part count
+ *    14   8  first 8 bytes of SHA-256(body)
+ *    22   …  body
+ *
+ * Data bodies are a slice of the ciphertext. File-level metadata lives only in
+ * the manifest code, as a list of TLV entries (tag u8, len u16 LE, value) so
+ * readers can skip tags they don't know. Legacy v1 codes are JSON objects and
+ * always start with '{', so the two formats can't be confused.
+ *
+ * Unlike v1, where every code repeated the metadata, nothing but the manifest
+ * describes the archive (key salts, nonce, sizes, codec), and parity covers
+ * only data chunks. It is therefore written kManifestCopies times
+ * (qr-manifest.png, qr-manifest-1.png, …; index = copy no); any one copy
+ * decodes the archive, losing all of them loses it.
+ */
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <openssl/sha.h>
+
+namespace gzqr::chunkfmt {
+
+inline constexpr uint8_t kVersion = 2;
+inline constexpr size_t kHeaderSize = 22;
+inline constexpr size_t kDigestSize = 8;
+inline constexpr int kManifestCopies = 2;
+enum kind : uint8_t { kData = 'D', kManifest = 'M', kSheet = 'S', kParity = 'P', kBlock = 'B', kRecipe = 'R', kIndex = 'I' };
+enum tag : uint8_t { tCipherSha = 1, tSalt = 2, tNonce = 3, tChunkSize = 4, tCipherSize = 5, tName = 6, tExt = 7, tCodec = 8, tParity = 9, tKeySalt = 10, tLayout = 11, tSegment = 12 };
+
+struct header { uint8_t kind=0, flags=0; uint32_t index=0, total=0; };
+struct chunk_view { header h; const uint8_t* body=nullptr; size_t size=0; };
+
+inline void put_u16(std::vector<uint8_t>& o,uint16_t v){ o.push_back(v&255); o.push_back(v>>8); }
+inline void put_u32(std::vector<uint8_t>& o,uint32_t v){ for(int i=0;i<4;i++) o.push_back((v>>(8*i))&255); }
+inline void put_u64(std::vector<uint8_t>& o,uint64_t v){ for(int i=0;i<8;i++) o.push_back((v>>(8*i))&255); }
+inline uint16_t get_u16(const uint8_t* p){ return (uint16_t)(p[0]|(p[1]<<8)); }
+inline uint32_t get_u32(const uint8_t* p){ uint32_t v=0; for(int i=3;i>=0;i--) v=(v<<8)|p[i]; return v; }
+inline uint64_t get_u64(const uint8_t* p){ uint64_t v=0; for(int i=7;i>=0;i--) v=(v<<8)|p[i]; return v; }
+
+inline bool is_binary(const uint8_t* p,size_t n){ return n>=4 && p[0]=='G' && p[1]=='Z' && p[2]=='Q'; }
+
+inline std::vector<uint8_t> build(const header& h,const uint8_t* body,size_t n){
+  std::vector<uint8_t> o; o.reserve(kHeaderSize+n);
+  o.insert(o.end(),{'G','Z','Q',kVersion,h.kind,h.flags});
+  put_u32(o,h.index); put_u32(o,h.total);
+  unsigned char d[32]; SHA256(body,n,d); o.insert(o.end(),d,d+kDigestSize);
+  o.insert(o.end(),body,body+n);
+  return o;
+}
+
+// Header only: false if the bytes are not a v2 chunk. The body is not checked yet.
+inline bool parse_header(const uint8_t* p,size_t n,chunk_view& out){
+  if(n<kHeaderSize || !is_binary(p,n) || p[3]!=kVersion) return false;
+  out.h.kind=p[4]; out.h.flags=p[5]; out.h.index=get_u32(p+6); out.h.total=get_u32(p+10);
+  out.body=p+kHeaderSize; out.size=n-kHeaderSize;
+  return true;
+}
+// Body digest of a chunk read by parse_header (p = the same bytes).
+inline bool body_ok(const uint8_t* p,const chunk_view& cv){
+  unsigned char d[32]; SHA256(cv.body,cv.size,d);
+  return std::memcmp(d,p+14,kDigestSize)==0;
+}
+// False if the bytes are not a v2 chunk or the body digest doesn't match.
+inline bool parse(const uint8_t* p,size_t n,chunk_view& out){ return parse_header(p,n,out) && body_ok(p,out); }
+
+// PNG name of manifest copy #i.
+inline std::string manifest_png(int copy){ return copy?"qr-manifest-"+std::to_string(copy)+".png":std::string("qr-manifest.png"); }
+
+struct manifest {
+  std::vector<uint8_t> cipherSha, salt, nonce;
+  std::vector<uint8_t> keySalt;   // batch runs: key = HKDF(scrypt(pass, salt), keySalt); absent = scrypt key
+  uint32_t chunkSize=0; uint64_t cipherSize=0;
+  std::string name, ext;
+  uint8_t codec=0;                // compress.hpp codec_id; absent = 0 (stored)
+  uint16_t parityN=0, parityK=0;  // K parity codes per N data codes; absent = none
+  uint8_t layout=0;               // 0 = one ciphertext in 'D' chunks, 1 = cdc blocks + recipe, 2 = segmented + toc
+  uint32_t segment=0;             // layout 2: plaintext bytes per sealed segment
+
+  std::vector<uint8_t> serialize()const{
+    std::vector<uint8_t> o;
+    auto tlv=[&](uint8_t t,const void* v,size_t n){
+      if(n>0xFFFF) throw std::runtime_error("manifest field too long");
+      o.push_back(t); put_u16(o,(uint16_t)n); const uint8_t* b=(const uint8_t*)v; o.insert(o.end(),b,b+n); };
+    std::vector<uint8_t> num;
+    tlv(tCipherSha,cipherSha.data(),cipherSha.size());
+    tlv(tSalt,salt.data(),salt.size());
+    tlv(tNonce,nonce.data(),nonce.size());
+    num.clear(); put_u32(num,chunkSize); tlv(tChunkSize,num.data(),num.size());
+    num.clear(); put_u64(num,cipherSize); tlv(tCipherSize,num.data(),num.size());
+    tlv(tName,name.data(),name.size());
+    tlv(tExt,ext.data(),ext.size());
+    if(codec) tlv(tCodec,&codec,1);
+    if(!keySalt.empty()) tlv(tKeySalt,keySalt.data(),keySalt.size());
+    if(layout) tlv(tLayout,&layout,1);
+    if(segment){ num.clear(); put_u32(num,segment); tlv(tSegment,num.data(),num.size()); }
+    if(parityK){ num.clear(); put_u16(num,parityN); put_u16(num,parityK); tlv(tParity,num.data(),num.size()); }
+    return o;
+  }
+  static manifest parse(const uint8_t* p,size_t n){
+    manifest m; size_t i=0;
+    while(i+3<=n){
+      uint8_t t=p[i]; size_t len=get_u16(p+i+1); i+=3;
+      if(i+len>n) throw std::runtime_error("manifest truncated");
+      const uint8_t* v=p+i; i+=len;
+      switch(t){
+        case tCipherSha: m.cipherSha.assign(v,v+len); break;
+        case tSalt:      m.salt.assign(v,v+len); break;
+        case tNonce:     m.nonce.assign(v,v+len); break;
+        case tChunkSize: if(len>=4) m.chunkSize=get_u32(v); break;
+        case tCipherSize:if(len>=8) m.cipherSize=get_u64(v); break;
+        case tName:      m.name.assign((const char*)v,len); break;
+        case tExt:       m.ext.assign((const char*)v,len); break;
+        case tCodec:     if(len>=1) m.codec=v[0]; break;
+        case tLayout:    if(len>=1) m.layout=v[0]; break;
+        case tSegment:   if(len>=4) m.segment=get_u32(v); break;
+        case tKeySalt:   m.keySalt.assign(v,v+len); break;
+        case tParity:    if(len>=4){ m.parityN=get_u16(v); m.parityK=get_u16(v+2); } break;
+        default: break; // newer writer; ignore
+      }
+    }
+    return m;
+  }
+};
+
+} // namespace gzqr::chunkfmt
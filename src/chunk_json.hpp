@@ -0,0 +1,179 @@
+#pragma once
+/*
+ * GitZipQR.cpp – v1 JSON chunk codes (--format json)
+ *
+ * A v1 code is one flat JSON object:
+ *
+ *   {"chunk":N,"chunkSize":N,"cipherHash":"<hex>","codec":"…","dataB64":"…",
+ *    "ext":"…","hash":"<hex>","keySaltB64":"…","name":"…","nonceB64":"…",
+ *    "saltB64":"…","total":N,"type":"<project>-CHUNK-ENC","version":"…"}
+ *
+ * Keys are in byte order and numbers are plain integers, exactly what
+ * mini_json used to print for the same object. "codec" and "keySaltB64" are
+ * left out when not needed. write() fills a buffer the caller keeps between
+ * chunks; parse() returns string_view slices into the code text, with
+ * escapes left in (unescape() for the few fields that get copied). Keys it
+ * doesn't know are skipped, whatever their value. String escapes are read
+ * the way mini_json read them: a backslash takes the next character as is.
+ */
+#include "text_codec.hpp"
+
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <openssl/sha.h>
+
+namespace gzqr::chunkjson {
+
+// What the encoder puts in every code besides the data. Empty codec or
+// keySaltB64: field omitted.
+struct fields {
+  std::string_view type, version, cipherHash, saltB64, nonceB64, keySaltB64, name, ext, codec;
+  int chunk=0, total=0, chunkSize=0;
+};
+
+namespace detail {
+inline void put_str(std::string& o,std::string_view s){
+  o+='"';
+  for(size_t i=0;i<s.size();){
+    size_t j=s.find_first_of("\"\\",i);
+    if(j==std::string_view::npos){ o.append(s.data()+i,s.size()-i); break; }
+    o.append(s.data()+i,j-i); o+='\\'; o+=s[j]; i=j+1;
+  }
+  o+='"';
+}
+inline void put_num(std::string& o,long long v){ char b[24]; auto r=std::to_chars(b,b+sizeof(b),v); o.append(b,r.ptr); }
+inline void key(std::string& o,const char* k,bool first=false){ if(!first) o+=','; o+='"'; o+=k; o+="\":"; }
+}
+
+// Replaces `out` with the code for `data` (hash and dataB64 computed here).
+inline void write(std::string& out,const fields& f,const uint8_t* data,size_t n){
+  using namespace detail;
+  out.clear();
+  out.reserve(text::b64_size(n)+256+f.cipherHash.size()+f.saltB64.size()+f.nonceB64.size()+f.keySaltB64.size()+f.name.size()+f.ext.size());
+  out+='{'; key(out,"chunk",true); put_num(out,f.chunk);
+  key(out,"chunkSize"); put_num(out,f.chunkSize);
+  key(out,"cipherHash"); put_str(out,f.cipherHash);
+  if(!f.codec.empty()){ key(out,"codec"); put_str(out,f.codec); }
+  key(out,"dataB64"); out+='"';
+  { size_t at=out.size(); out.resize(at+text::b64_size(n)); text::b64_encode(data,n,&out[at]); }
+  out+='"';
+  key(out,"ext"); put_str(out,f.ext);
+  key(out,"hash"); out+='"';
+  { unsigned char h[32]; SHA256(data,n,h); size_t at=out.size(); out.resize(at+64); text::hex_encode(h,32,&out[at]); }
+  out+='"';
+  if(!f.keySaltB64.empty()){ key(out,"keySaltB64"); put_str(out,f.keySaltB64); }
+  key(out,"name"); put_str(out,f.name);
+  key(out,"nonceB64"); put_str(out,f.nonceB64);
+  key(out,"saltB64"); put_str(out,f.saltB64);
+  key(out,"total"); put_num(out,f.total);
+  key(out,"type"); put_str(out,f.type);
+  key(out,"version"); put_str(out,f.version);
+  out+='}';
+}
+
+// ---------------- Reading ----------------
+// One parsed code. String fields are raw slices of the input (no quotes).
+struct view {
+  std::string_view type, version, hash, cipherHash, saltB64, nonceB64, keySaltB64, name, ext, codec, dataB64;
+  double chunk=0, total=0, chunkSize=0;
+  unsigned seen=0;                    // bit per field below
+  enum : unsigned { fType=1, fChunk=2, fTotal=4, fHash=8, fData=16, fChunkSize=32, fCipherHash=64, fSalt=128, fNonce=256,
+                    fKeySalt=512, fName=1024, fExt=2048, fCodec=4096 };
+  static constexpr unsigned kRequired=fChunk|fTotal|fHash|fData|fChunkSize|fCipherHash|fSalt|fNonce;
+  bool has(unsigned f)const{ return (seen&f)!=0; }
+};
+
+inline std::string unescape(std::string_view s){
+  std::string r; r.reserve(s.size());
+  for(size_t i=0;i<s.size();i++){ if(s[i]=='\\' && i+1<s.size()) i++; r+=s[i]; }
+  return r;
+}
+// Compares a raw slice with plain text, escapes taken into account.
+inline bool equals(std::string_view raw,std::string_view s){
+  return raw.find('\\')==std::string_view::npos ? raw==s : unescape(raw)==s;
+}
+
+namespace detail {
+struct reader {
+  std::string_view s; size_t i=0;
+  [[noreturn]] static void fail(const char* what){ throw std::runtime_error(std::string("json parse: ")+what); }
+  void ws(){ while(i<s.size() && (s[i]==' '||s[i]=='\t'||s[i]=='\n'||s[i]=='\r')) i++; }
+  char peek(){ ws(); if(i>=s.size()) fail("eof"); return s[i]; }
+  void expect(char c){ if(peek()!=c) fail("unexpected character"); i++; }
+  std::string_view str(){
+    expect('"'); size_t b=i;
+    for(;;){   // next quote, unless an odd run of backslashes escapes it
+      const void* q=i<s.size()?std::memchr(s.data()+i,'"',s.size()-i):nullptr;
+      if(!q) fail("unterminated string");
+      i=(size_t)((const char*)q-s.data());
+      size_t k=i; while(k>b && s[k-1]=='\\') k--;
+      if((i-k)%2==0) break;
+      i++;
+    }
+    return s.substr(b,(i++)-b);
+  }
+  double num(){
+    ws(); size_t b=i;
+    while(i<s.size() && ((s[i]>='0'&&s[i]<='9')||s[i]=='-'||s[i]=='+'||s[i]=='.'||s[i]=='e'||s[i]=='E')) i++;
+    double d=0; auto r=std::from_chars(s.data()+b,s.data()+i,d);
+    if(b==i || r.ec!=std::errc() || r.ptr!=s.data()+i) fail("bad number");
+    return d;
+  }
+  void skip(){
+    char c=peek();
+    if(c=='"'){ str(); return; }
+    if(c=='{'||c=='['){
+      int depth=0;
+      do{
+        c=peek();
+        if(c=='"'){ str(); continue; }
+        if(c=='{'||c=='[') depth++; else if(c=='}'||c==']') depth--;
+        i++;
+      }while(depth>0);
+      return;
+    }
+    for(const char* w:{"true","false","null"}) if(s.compare(i,std::strlen(w),w)==0){ i+=std::strlen(w); return; }
+    num();
+  }
+};
+}
+
+// Fills `v` from one code. Throws on malformed JSON or a wrong type for a
+// known field; missing fields (or a value that isn't an object) just leave
+// their bits in v.seen clear.
+inline void parse(std::string_view s,view& v){
+  detail::reader r{s};
+  v=view{};
+  if(r.peek()!='{'){ r.skip(); return; }   // valid JSON, just not ours
+  r.i++;
+  if(r.peek()=='}'){ r.i++; return; }
+  while(true){
+    std::string_view k=r.str(); r.expect(':');
+    auto sv=[&](std::string_view& dst,unsigned bit){ dst=r.str(); v.seen|=bit; };
+    auto nv=[&](double& dst,unsigned bit){ dst=r.num(); v.seen|=bit; };
+    if(k=="type") sv(v.type,view::fType);
+    else if(k=="version") sv(v.version,0);
+    else if(k=="chunk") nv(v.chunk,view::fChunk);
+    else if(k=="total") nv(v.total,view::fTotal);
+    else if(k=="hash") sv(v.hash,view::fHash);
+    else if(k=="dataB64") sv(v.dataB64,view::fData);
+    else if(k=="chunkSize") nv(v.chunkSize,view::fChunkSize);
+    else if(k=="cipherHash") sv(v.cipherHash,view::fCipherHash);
+    else if(k=="saltB64") sv(v.saltB64,view::fSalt);
+    else if(k=="nonceB64") sv(v.nonceB64,view::fNonce);
+    else if(k=="keySaltB64") sv(v.keySaltB64,view::fKeySalt);
+    else if(k=="name") sv(v.name,view::fName);
+    else if(k=="ext") sv(v.ext,view::fExt);
+    else if(k=="codec") sv(v.codec,view::fCodec);
+    else r.skip();
+    char c=r.peek(); r.i++;
+    if(c=='}') return;
+    if(c!=',') detail::reader::fail("expected , or }");
+  }
+}
+
+} // namespace gzqr::chunkjson
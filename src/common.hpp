@@ -8,30 +8,28 @@
 #include <cstdlib>
 #include <thread>
 #include <openssl/evp.h>
+#include <openssl/kdf.h>
 #include <openssl/rand.h>
 #include <openssl/sha.h>
 #include <termios.h>
 #include <iostream>
 #include <unistd.h>
+#include "text_codec.hpp"
 namespace gzqr {
 
 // forward decl for encoder PNG writer
 void save_qr_png_lib(const std::string& out, const std::string& text, int ecl_level, int version, int margin, int scale);
 struct KDFParams { uint64_t N; uint32_t r; uint32_t p; };
-inline std::string sha256_hex(const std::vector<uint8_t>& buf){ unsigned char h[32]; SHA256(buf.data(), buf.size(), h);
-  static const char* X="0123456789abcdef"; std::string s(64,'0'); for(int i=0;i<32;i++){ s[2*i]=X[(h[i]>>4)&15]; s[2*i+1]=X[h[i]&15]; } return s; }
+inline std::string hex(const unsigned char* p,size_t n){ std::string s(2*n,'0'); text::hex_encode(p,n,s.data()); return s; }
+inline std::vector<uint8_t> unhex(const std::string& s){ auto nib=[](char c)->int{ return c<='9'?c-'0':(c|0x20)-'a'+10; };
+  std::vector<uint8_t> o(s.size()/2); for(size_t i=0;i<o.size();i++) o[i]=(uint8_t)((nib(s[2*i])<<4)|nib(s[2*i+1])); return o; }
+inline std::string sha256_hex(const std::vector<uint8_t>& buf){ unsigned char h[32]; SHA256(buf.data(), buf.size(), h); return hex(h,32); }
 inline std::string sha256_hex_file(const std::string& path){ FILE* f=fopen(path.c_str(),"rb"); if(!f) throw std::runtime_error("open sha256");
   SHA256_CTX c; SHA256_Init(&c); std::vector<uint8_t>b(1<<20); size_t n; while((n=fread(b.data(),1,b.size(),f))>0) SHA256_Update(&c,b.data(),n);
-  fclose(f); unsigned char h[32]; SHA256_Final(h,&c); static const char* X="0123456789abcdef"; std::string s(64,'0'); for(int i=0;i<32;i++){ s[2*i]=X[(h[i]>>4)&15]; s[2*i+1]=X[h[i]&15]; } return s; }
-inline std::string b64(const std::vector<uint8_t>& in){ static const char* t="ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
-  std::string o; o.reserve(((in.size()+2)/3)*4); size_t i=0; while(i+3<=in.size()){ uint32_t v=(in[i]<<16)|(in[i+1]<<8)|in[i+2]; i+=3;
-    o.push_back(t[(v>>18)&63]); o.push_back(t[(v>>12)&63]); o.push_back(t[(v>>6)&63]); o.push_back(t[v&63]); }
-  if(i+1==in.size()){ uint32_t v=(in[i]<<16); o.push_back(t[(v>>18)&63]); o.push_back(t[(v>>12)&63]); o.push_back('='); o.push_back('='); }
-  else if(i+2==in.size()){ uint32_t v=(in[i]<<16)|(in[i+1]<<8); o.push_back(t[(v>>18)&63]); o.push_back(t[(v>>12)&63]); o.push_back(t[(v>>6)&63]); o.push_back('='); }
-  return o; }
-inline std::vector<uint8_t> b64d(const std::string& s){ int T[256]; for(int i=0;i<256;i++) T[i]=-1; std::string tab="ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
-  for(int i=0;i<64;i++) T[(unsigned char)tab[i]]=i; std::vector<uint8_t> o; o.reserve(s.size()*3/4);
-  int val=0,valb=-8; for(unsigned char c:s){ if(T[c]==-1){ if(c=='=') break; else continue; } val=(val<<6)+T[c]; valb+=6; if(valb>=0){ o.push_back((uint8_t)((val>>valb)&255)); valb-=8; } } return o; }
+  fclose(f); unsigned char h[32]; SHA256_Final(h,&c); return hex(h,32); }
+// base64/hex kernels (SIMD where available) live in text_codec.hpp; these size the result once.
+inline std::string b64(const std::vector<uint8_t>& in){ std::string o(text::b64_size(in.size()),'\0'); text::b64_encode(in.data(),in.size(),o.data()); return o; }
+inline std::vector<uint8_t> b64d(const std::string& s){ std::vector<uint8_t> o(text::b64_decoded_max(s.size())); o.resize(text::b64_decode(s.data(),s.size(),o.data())); return o; }
 inline std::string join_passwords(const std::vector<std::string>& parts){ std::string r; for(size_t i=0;i<parts.size();++i){ if(i) r.push_back('\0'); r+=parts[i]; } return r; }
 inline std::string prompt_hidden(const std::string& label){ const char* pf = std::getenv("GZQR_PASSFILE");
   if(pf && *pf){ FILE* f=fopen(pf,"rb"); if(!f) throw std::runtime_error("GZQR_PASSFILE open"); std::string s; char buf[4096]; size_t n;
@@ -42,6 +40,13 @@ inline std::string prompt_hidden(const std::string& label){ const char* pf = std
 inline std::vector<uint8_t> scrypt_kdf(const std::string& pass, const std::vector<uint8_t>& salt, const KDFParams& k){
   std::vector<uint8_t> key(32); if(1!=EVP_PBE_scrypt(pass.c_str(), pass.size(), salt.data(), salt.size(), k.N, k.r, k.p, 512ull*1024*1024, key.data(), key.size()))
     throw std::runtime_error("scrypt failed"); return key; }
+// HKDF-SHA256 (RFC 5869): per-archive keys from one scrypt result in batch runs.
+inline std::vector<uint8_t> hkdf_sha256(const std::vector<uint8_t>& ikm, const std::vector<uint8_t>& salt, const std::string& info){
+  std::vector<uint8_t> out(32); size_t n=out.size(); EVP_PKEY_CTX* c=EVP_PKEY_CTX_new_id(EVP_PKEY_HKDF, nullptr);
+  bool ok=c && 1==EVP_PKEY_derive_init(c) && 1==EVP_PKEY_CTX_set_hkdf_md(c, EVP_sha256()) && 1==EVP_PKEY_CTX_set1_hkdf_salt(c, salt.data(), (int)salt.size())
+    && 1==EVP_PKEY_CTX_set1_hkdf_key(c, ikm.data(), (int)ikm.size()) && 1==EVP_PKEY_CTX_add1_hkdf_info(c, (const unsigned char*)info.data(), (int)info.size())
+    && 1==EVP_PKEY_derive(c, out.data(), &n);
+  EVP_PKEY_CTX_free(c); if(!ok || n!=out.size()) throw std::runtime_error("hkdf failed"); return out; }
 inline void aes_gcm_encrypt_file(const std::string& in, const std::string& out, const std::vector<uint8_t>& key, const std::vector<uint8_t>& nonce, const std::vector<uint8_t>& aad){
   EVP_CIPHER_CTX* ctx=EVP_CIPHER_CTX_new(); if(!ctx) throw std::runtime_error("ctx"); FILE* fi=fopen(in.c_str(),"rb"); if(!fi){EVP_CIPHER_CTX_free(ctx); throw std::runtime_error("open in");}
   FILE* fo=fopen(out.c_str(),"wb"); if(!fo){fclose(fi); EVP_CIPHER_CTX_free(ctx); throw std::runtime_error("open out");}
@@ -0,0 +1,240 @@
+#pragma once
+/*
+ * GitZipQR.cpp – pre-encryption compression
+ *
+ * Ciphertext doesn't compress, so this stage sits between the input and the
+ * encryptor. Every byte saved is roughly 1/2900 of a QR code. Codecs are
+ * streaming byte_sinks: deflate (zlib), xz (liblzma) and, when built with
+ * GZQR_HAVE_ZSTD, zstd. "auto" buffers a sample of the input and tries a
+ * quick deflate on it. If the sample barely shrinks (already compressed
+ * media, archives) the data is stored; otherwise xz is used for the best
+ * ratio, since QR rendering is the bottleneck rather than the compressor.
+ * The chosen codec id travels in the archive metadata.
+ */
+#include "stream.hpp"
+
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <lzma.h>
+#include <zlib.h>
+#ifdef GZQR_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace gzqr {
+
+enum codec_id : uint8_t { kCodecNone = 0, kCodecDeflate = 1, kCodecXz = 2, kCodecZstd = 3 };
+
+inline const char* codec_name(int c){
+  switch(c){ case kCodecNone: return "none"; case kCodecDeflate: return "deflate"; case kCodecXz: return "xz"; case kCodecZstd: return "zstd"; }
+  return "?";
+}
+inline bool codec_from_name(const std::string& s,int& c){
+  for(int k=kCodecNone;k<=kCodecZstd;k++) if(s==codec_name(k)){ c=k; return true; }
+  return false;
+}
+inline bool codec_available(int c){
+#ifdef GZQR_HAVE_ZSTD
+  return c>=kCodecNone && c<=kCodecZstd;
+#else
+  return c>=kCodecNone && c<=kCodecXz;
+#endif
+}
+
+// "--compress" value: none | auto | deflate[:0-9] | xz[:0-9] | zstd[:1-22]; level -1 = codec default.
+struct compress_opts { bool autoSelect=true; int codec=kCodecNone; int level=-1; };
+inline bool parse_compress(const std::string& s,compress_opts& o){
+  if(s=="auto"){ o=compress_opts{}; return true; }
+  auto colon=s.find(':');
+  compress_opts r; r.autoSelect=false;
+  if(!codec_from_name(s.substr(0,colon),r.codec) || !codec_available(r.codec)) return false;
+  if(colon!=std::string::npos){
+    static const int lo[]={1,0,0,1}, hi[]={0,9,9,22};   // by codec_id; none takes no level
+    const std::string lv=s.substr(colon+1);
+    if(lv.empty() || lv.size()>2 || lv.find_first_not_of("0123456789")!=std::string::npos) return false;
+    r.level=std::stoi(lv);
+    if(r.level<lo[r.codec] || r.level>hi[r.codec]) return false;
+  }
+  o=r; return true;
+}
+
+// ---------------- deflate ----------------
+class deflate_sink : public byte_sink {
+public:
+  deflate_sink(int level,byte_sink& next):next_(next),buf_(1<<16){
+    if(deflateInit(&z_,level<0?Z_DEFAULT_COMPRESSION:level)!=Z_OK) throw std::runtime_error("deflateInit");
+  }
+  ~deflate_sink(){ deflateEnd(&z_); }
+  void write(const uint8_t* p,size_t n)override{ run(p,n,Z_NO_FLUSH); }
+  void finish()override{ run(nullptr,0,Z_FINISH); next_.finish(); }
+private:
+  void run(const uint8_t* p,size_t n,int flush){
+    z_.next_in=(Bytef*)p; z_.avail_in=(uInt)n;
+    do{
+      z_.next_out=buf_.data(); z_.avail_out=(uInt)buf_.size();
+      int r=deflate(&z_,flush); if(r==Z_STREAM_ERROR) throw std::runtime_error("deflate");
+      size_t have=buf_.size()-z_.avail_out; if(have) next_.write(buf_.data(),have);
+      if(flush==Z_FINISH && r==Z_STREAM_END) break;
+    }while(z_.avail_out==0 || (flush==Z_FINISH));
+  }
+  byte_sink& next_; z_stream z_{}; std::vector<uint8_t> buf_;
+};
+
+class inflate_sink : public byte_sink {
+public:
+  explicit inflate_sink(byte_sink& next):next_(next),buf_(1<<16){ if(inflateInit(&z_)!=Z_OK) throw std::runtime_error("inflateInit"); }
+  ~inflate_sink(){ inflateEnd(&z_); }
+  void write(const uint8_t* p,size_t n)override{
+    z_.next_in=(Bytef*)p; z_.avail_in=(uInt)n;
+    while(z_.avail_in>0 && !done_){
+      z_.next_out=buf_.data(); z_.avail_out=(uInt)buf_.size();
+      int r=inflate(&z_,Z_NO_FLUSH);
+      if(r!=Z_OK && r!=Z_STREAM_END && r!=Z_BUF_ERROR) throw std::runtime_error("inflate: corrupt stream");
+      size_t have=buf_.size()-z_.avail_out; if(have) next_.write(buf_.data(),have);
+      if(r==Z_STREAM_END) done_=true; else if(r==Z_BUF_ERROR && have==0) break;
+    }
+  }
+  void finish()override{ if(!done_) throw std::runtime_error("inflate: truncated stream"); next_.finish(); }
+private: byte_sink& next_; z_stream z_{}; std::vector<uint8_t> buf_; bool done_=false;
+};
+
+// ---------------- xz ----------------
+class lzma_sink : public byte_sink {
+public:
+  // encode: level 0-9 (-1 = 6); decode: level ignored.
+  lzma_sink(bool encode,int level,byte_sink& next):next_(next),enc_(encode),buf_(1<<16){
+    lzma_ret r=encode ? lzma_easy_encoder(&s_,(uint32_t)(level<0?6:level),LZMA_CHECK_CRC64)
+                      : lzma_stream_decoder(&s_,UINT64_MAX,0);
+    if(r!=LZMA_OK) throw std::runtime_error("lzma init");
+  }
+  ~lzma_sink(){ lzma_end(&s_); }
+  void write(const uint8_t* p,size_t n)override{ run(p,n,LZMA_RUN); }
+  void finish()override{ run(nullptr,0,LZMA_FINISH); if(!end_) throw std::runtime_error("xz: truncated stream"); next_.finish(); }
+private:
+  void run(const uint8_t* p,size_t n,lzma_action a){
+    s_.next_in=p; s_.avail_in=n;
+    while(!end_ && (s_.avail_in>0 || a==LZMA_FINISH)){
+      s_.next_out=buf_.data(); s_.avail_out=buf_.size();
+      lzma_ret r=lzma_code(&s_,a);
+      size_t have=buf_.size()-s_.avail_out; if(have) next_.write(buf_.data(),have);
+      if(r==LZMA_STREAM_END){ end_=true; break; }
+      if(r!=LZMA_OK) throw std::runtime_error(enc_?"xz encode":"xz: corrupt stream");
+    }
+  }
+  byte_sink& next_; bool enc_; lzma_stream s_=LZMA_STREAM_INIT; std::vector<uint8_t> buf_; bool end_=false;
+};
+
+// ---------------- zstd ----------------
+#ifdef GZQR_HAVE_ZSTD
+class zstd_sink : public byte_sink {
+public:
+  zstd_sink(int level,byte_sink& next):next_(next),c_(ZSTD_createCCtx()),buf_(ZSTD_CStreamOutSize()){
+    if(!c_) throw std::runtime_error("zstd init");
+    ZSTD_CCtx_setParameter(c_,ZSTD_c_compressionLevel,level<0?ZSTD_CLEVEL_DEFAULT:level);
+  }
+  ~zstd_sink(){ ZSTD_freeCCtx(c_); }
+  void write(const uint8_t* p,size_t n)override{ run(p,n,ZSTD_e_continue); }
+  void finish()override{ run(nullptr,0,ZSTD_e_end); next_.finish(); }
+private:
+  void run(const uint8_t* p,size_t n,ZSTD_EndDirective mode){
+    ZSTD_inBuffer in{p,n,0};
+    for(;;){
+      ZSTD_outBuffer out{buf_.data(),buf_.size(),0};
+      size_t left=ZSTD_compressStream2(c_,&out,&in,mode);
+      if(ZSTD_isError(left)) throw std::runtime_error("zstd compress");
+      if(out.pos) next_.write(buf_.data(),out.pos);
+      if(mode==ZSTD_e_end ? left==0 : in.pos==in.size) break;
+    }
+  }
+  byte_sink& next_; ZSTD_CCtx* c_; std::vector<uint8_t> buf_;
+};
+class unzstd_sink : public byte_sink {
+public:
+  explicit unzstd_sink(byte_sink& next):next_(next),d_(ZSTD_createDCtx()),buf_(ZSTD_DStreamOutSize()){ if(!d_) throw std::runtime_error("zstd init"); }
+  ~unzstd_sink(){ ZSTD_freeDCtx(d_); }
+  void write(const uint8_t* p,size_t n)override{
+    ZSTD_inBuffer in{p,n,0};
+    while(in.pos<in.size){
+      ZSTD_outBuffer out{buf_.data(),buf_.size(),0};
+      last_=ZSTD_decompressStream(d_,&out,&in);
+      if(ZSTD_isError(last_)) throw std::runtime_error("zstd: corrupt stream");
+      if(out.pos) next_.write(buf_.data(),out.pos);
+    }
+  }
+  void finish()override{ if(last_!=0) throw std::runtime_error("zstd: truncated stream"); next_.finish(); }
+private: byte_sink& next_; ZSTD_DCtx* d_; std::vector<uint8_t> buf_; size_t last_=1;
+};
+#endif
+
+// ---------------- factory ----------------
+// Pass-through for kCodecNone, so callers can always build the same chain.
+struct forward_sink : byte_sink {
+  explicit forward_sink(byte_sink& next):next_(next){}
+  void write(const uint8_t* p,size_t n)override{ next_.write(p,n); }
+  void finish()override{ next_.finish(); }
+private: byte_sink& next_;
+};
+
+inline std::unique_ptr<byte_sink> make_compressor(int codec,int level,byte_sink& next){
+  switch(codec){
+    case kCodecNone:    return std::make_unique<forward_sink>(next);
+    case kCodecDeflate: return std::make_unique<deflate_sink>(level,next);
+    case kCodecXz:      return std::make_unique<lzma_sink>(true,level,next);
+#ifdef GZQR_HAVE_ZSTD
+    case kCodecZstd:    return std::make_unique<zstd_sink>(level,next);
+#endif
+  }
+  throw std::runtime_error(std::string("codec not available: ")+codec_name(codec));
+}
+inline std::unique_ptr<byte_sink> make_decompressor(int codec,byte_sink& next){
+  switch(codec){
+    case kCodecNone:    return std::make_unique<forward_sink>(next);
+    case kCodecDeflate: return std::make_unique<inflate_sink>(next);
+    case kCodecXz:      return std::make_unique<lzma_sink>(false,-1,next);
+#ifdef GZQR_HAVE_ZSTD
+    case kCodecZstd:    return std::make_unique<unzstd_sink>(next);
+#endif
+  }
+  throw std::runtime_error(std::string("archive needs codec ")+codec_name(codec)+", not built in");
+}
+
+// Counts bytes written through it (used by the auto sampler).
+struct count_sink : byte_sink {
+  uint64_t n=0;
+  void write(const uint8_t*,size_t k)override{ n+=k; }
+};
+
+// The compression stage. With autoSelect the first `sample` bytes are held
+// back, test-compressed with deflate level 1, and the codec is fixed before
+// anything reaches `next`. codec() is final once finish() returned.
+class compress_sink : public byte_sink {
+public:
+  static constexpr size_t kSample=1<<20;
+  compress_sink(const compress_opts& o,byte_sink& next):o_(o),next_(next){
+    if(!o_.autoSelect) inner_=make_compressor(o_.codec,o_.level,next_); else sample_.reserve(kSample);
+  }
+  void write(const uint8_t* p,size_t n)override{
+    if(inner_){ inner_->write(p,n); return; }
+    size_t k=std::min(n,kSample-sample_.size());
+    sample_.insert(sample_.end(),p,p+k);
+    if(sample_.size()==kSample) decide();
+    if(n>k) inner_->write(p+k,n-k);
+  }
+  void finish()override{ if(!inner_) decide(); inner_->finish(); }
+  int codec()const{ return o_.codec; }
+private:
+  void decide(){
+    count_sink c; { deflate_sink d(1,c); d.write(sample_.data(),sample_.size()); d.finish(); }
+    o_.codec = (c.n*100 >= (uint64_t)sample_.size()*95) ? kCodecNone : kCodecXz;
+    inner_=make_compressor(o_.codec,o_.level,next_);
+    inner_->write(sample_.data(),sample_.size());
+    std::vector<uint8_t>().swap(sample_);
+  }
+  compress_opts o_; byte_sink& next_; std::unique_ptr<byte_sink> inner_; std::vector<uint8_t> sample_;
+};
+
+} // namespace gzqr
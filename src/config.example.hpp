@@ -35,6 +35,50 @@ namespace gzqr_config
   inline constexpr int kDefaultQRVersion = 40; // Max QR size (v40 = 177×177 modules)
   inline constexpr int kDefaultQRMargin = 1;   // Margin (quiet zone) around QR
   inline constexpr int kDefaultQRScale = 8;    // PNG scaling factor (pixels per module)
+  // Chunk payload: "bin" = compact v2 binary codes + one manifest code,
+  // "json" = legacy v1 JSON/base64 codes (metadata repeated in every code).
+  inline constexpr const char *kDefaultChunkFormat = "bin";
+  // Compression before encryption: auto|none|deflate[:N]|xz[:N]|zstd[:N]
+  // (zstd only when built against libzstd). "auto" stores data that a quick
+  // test on the first 1 MiB shows to be incompressible, and uses xz otherwise.
+  inline constexpr const char *kDefaultCompression = "auto";
+  // Parity codes (binary format): "off", "N+K" = K parity codes per N data
+  // codes, or "P%" = P% extra over groups of kDefaultParityGroup. Any K codes
+  // per group may then be lost or damaged.
+  inline constexpr const char *kDefaultParity = "off";
+  inline constexpr int kDefaultParityGroup = 32;
+
+  // ── PNG output ────────────────────────────────────────────────────────
+  // "gray1" = 1-bit grayscale (32× less pixel data), "rgba" = legacy 8-bit RGBA.
+  // zlib level 0-9 (-1 = libpng default), strategy auto|default|filtered|huffman|rle|fixed,
+  // row filter default|none|sub|up|avg|paeth|all. See `make bench` for the trade-offs.
+  inline constexpr const char *kDefaultPngMode = "gray1";
+  inline constexpr int kDefaultPngZLevel = -1;
+  inline constexpr const char *kDefaultPngStrategy = "auto";
+  inline constexpr const char *kDefaultPngFilter = "default";
+
+  // ── Indexed archives (--indexed) ─────────────────────────────────────
+  // Plaintext bytes per independently sealed segment. --extract decrypts
+  // whole segments, so smaller ones mean fewer codes read per file and a
+  // little less compression.
+  inline constexpr int kIndexSegmentSize = 64 << 10;
+
+  // ── Frame streams (--frames) ─────────────────────────────────────────
+  // Encoder: Y4M frame rate, i.e. codes shown per second when played back.
+  inline constexpr int kFrameRate = 6;
+  // Encoder: the manifest frames lead the video and one is repeated after
+  // every this many code frames (written to a file; a pipe gets them last).
+  inline constexpr int kFrameManifestEvery = 30;
+  // Decoder: a frame whose 256-bit block hash differs from the previous
+  // frame's in at most this many bits counts as a repeat and is skipped.
+  inline constexpr int kFrameRepeatBits = 16;
+
+  // ── Parallelism ───────────────────────────────────────────────────────
+  // Worker threads for QR encode / PNG write (0 = hardware_concurrency()).
+  // Override per run with --jobs N.
+  inline constexpr int kDefaultJobs = 0;
+  // Chunks allowed to wait in the queue per worker (bounds encoder memory).
+  inline constexpr int kQueuedChunksPerJob = 4;
 
   // ── Password config ───────────────────────────────────────────────────
   // WARNING: Storing passwords in source code is insecure!
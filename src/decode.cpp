@@ -3,123 +3,304 @@
  * Author: Daniil V (RestlessByte)[https://github.com/RestlessByte]
  * License: MIT
  *
- * Reads PNG QR codes, reconstructs encrypted chunks, verifies SHA256, and
- * decrypts via AES-256-GCM to the original file/zip.
+ * Reads PNG QR codes and streams the chunks, in index order, through
+ * SHA-256, AES-256-GCM and the decompressor (codec from the metadata)
+ * straight into the original file/zip: one pass, no temporary files. Both
+ * the v2 binary chunk format and legacy v1 JSON codes are recognised per
+ * code. Chunks that never turn up are rebuilt from parity codes, if the
+ * archive has them. Incremental archives (cdc.hpp) are put together from
+ * their blocks by offset instead. The assembler itself lives in
+ * assembler.hpp (shared with libgzqr); this file finds and reads the PNGs,
+ * or the frames of a recording (--frames, frames.hpp). --extract restores
+ * single files from an indexed archive (indexed.hpp) and reads only the
+ * codes they need.
  */
 
 #include "common.hpp"
 #include "config.hpp"
-#include "third_party/json.hpp"
+#include "pool.hpp"
+#include "assembler.hpp"
+#include "frames.hpp"
+#include "indexed.hpp"
 
-#include <ZXing/ReadBarcode.h>
-#include <ZXing/BarcodeFormat.h>
-#include <ZXing/ReaderOptions.h>
-#include <png.h>
+#include <algorithm>
+#include <atomic>
 #include <filesystem>
-#include <map>
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <vector>
 #include <iostream>
 
 using namespace gzqr;
-using mini_json::value;
-
-// ---------------- PNG reader ----------------
-static std::vector<uint8_t> png_rgba(const std::string& p, int& w, int& h){
-  FILE* fp=fopen(p.c_str(),"rb"); if(!fp) throw std::runtime_error("open png");
-  png_structp png_ptr=png_create_read_struct(PNG_LIBPNG_VER_STRING,nullptr,nullptr,nullptr);
-  if(!png_ptr){ fclose(fp); throw std::runtime_error("png_read_struct"); }
-  png_infop info_ptr=png_create_info_struct(png_ptr);
-  if(!info_ptr){ png_destroy_read_struct(&png_ptr,nullptr,nullptr); fclose(fp); throw std::runtime_error("png_info_struct"); }
-  if(setjmp(png_jmpbuf(png_ptr))){ png_destroy_read_struct(&png_ptr,&info_ptr,nullptr); fclose(fp); throw std::runtime_error("png read"); }
-  png_init_io(png_ptr, fp); png_read_info(png_ptr, info_ptr);
-  w=png_get_image_width(png_ptr,info_ptr); h=png_get_image_height(png_ptr,info_ptr);
-  png_byte ct=png_get_color_type(png_ptr,info_ptr), bd=png_get_bit_depth(png_ptr,info_ptr);
-  if(bd==16) png_set_strip_16(png_ptr);
-  if(ct==PNG_COLOR_TYPE_PALETTE) png_set_palette_to_rgb(png_ptr);
-  if(ct==PNG_COLOR_TYPE_GRAY && bd<8) png_set_expand_gray_1_2_4_to_8(png_ptr);
-  if(png_get_valid(png_ptr,info_ptr,PNG_INFO_tRNS)) png_set_tRNS_to_alpha(png_ptr);
-  if(ct==PNG_COLOR_TYPE_RGB || ct==PNG_COLOR_TYPE_GRAY || ct==PNG_COLOR_TYPE_PALETTE) png_set_filler(png_ptr,0xFF,PNG_FILLER_AFTER);
-  if(ct==PNG_COLOR_TYPE_GRAY || ct==PNG_COLOR_TYPE_GRAY_ALPHA) png_set_gray_to_rgb(png_ptr);
-  png_read_update_info(png_ptr, info_ptr);
-  std::vector<uint8_t> img((size_t)w*h*4); std::vector<png_bytep> rows(h);
-  for(int y=0;y<h;y++) rows[y]=img.data()+ (size_t)y*w*4;
-  png_read_image(png_ptr, rows.data());
-  png_destroy_read_struct(&png_ptr,&info_ptr,nullptr); fclose(fp); return img;
+
+// Decodes every code in one PNG (a single code or a sheet).
+static void scan_file(const std::string& path,stream_assembler& table,std::mutex* outMu){
+  raster r;
+  { stat_scope sc(stPngRead,0,true); r=png_read(path); sc.add_bytes(r.px.size()); }
+  scan_image(r,table,outMu);
+}
+
+// PNGs of one archive: name order, manifest codes first, then recipe codes.
+static std::vector<std::string> list_pngs(const std::string& dir){
+  std::vector<std::string> files;
+  for(auto& e: std::filesystem::directory_iterator(dir))
+    if(e.is_regular_file() && e.path().extension()==".png") files.push_back(e.path().string());
+  auto rank=[](const std::string& f){ return f.find("manifest")!=std::string::npos?0:f.find("recipe")!=std::string::npos?1:2; };
+  std::sort(files.begin(),files.end(),[&](const std::string& a,const std::string& b){
+    int ra=rank(a), rb=rank(b); return ra!=rb ? ra<rb : a<b; });
+  return files;
+}
+
+// ---------------- Frame stream ----------------
+// Feeds the frames of a Y4M file or raw grey stream ("-" = stdin) to the
+// pool, skipping repeats, until the stream ends or every chunk is in.
+static void scan_frames(const std::string& src,int rawW,int rawH,stream_assembler& table,std::mutex& outMu,unsigned nthreads){
+  FILE* f=src=="-"?stdin:fopen(src.c_str(),"rb");
+  if(!f) throw std::runtime_error("open "+src);
+  struct closer { FILE* f; ~closer(){ if(f!=stdin) fclose(f); } } c{f};
+  frame_reader in(f,rawW,rawH);
+  const int w=in.width(), h=in.height();
+  std::fprintf(stdout,"STEP #1 read frames ... (%dx%d)\n",w,h);
+  std::fprintf(stdout,"STEP #2 scan & decrypt ... (jobs=%u)\n",nthreads);
+  int frames=0, scanned=0; bool early=false;
+  {
+    worker_pool pool(nthreads,(size_t)nthreads*gzqr_config::kQueuedChunksPerJob);
+    frame_hash prev; bool havePrev=false;
+    std::vector<uint8_t> y;
+    while(in.next(y)){
+      frames++;
+      frame_hash fh=hash_frame(y.data(),w,h);
+      bool repeat=havePrev && fh.distance(prev)<=gzqr_config::kFrameRepeatBits;
+      prev=fh; havePrev=true;
+      if(repeat) continue;
+      raster r; r.w=w; r.h=h; r.channels=1; r.px.swap(y);
+      scanned++;
+      pool.submit([&table,&outMu,r=std::move(r)]{ scan_image(r,table,&outMu); });
+      if(table.complete()){ early=true; break; }
+    }
+    pool.wait();
+  }
+  std::fprintf(stdout,"   %d frames read, %d scanned%s\n",frames,scanned,early?"; stopped once every chunk was in":"");
+}
+
+// ---------------- Extract ----------------
+/*
+ * --extract (indexed archives, indexed.hpp): reads a manifest copy and the
+ * qr-index-*.png codes, then, per matching file, only the qr-NNNNNN.png
+ * codes in its ciphertext range, a window at a time on the pool, and opens
+ * just the segment records they hold. Parity codes aren't read here.
+ */
+// The v2 code in one PNG, if it is valid and of `kind`.
+static bool read_v2(const std::string& path,uint8_t kind,std::string& raw,chunkfmt::chunk_view& cv){
+  if(!std::filesystem::exists(path)) return false;
+  raster r;
+  { stat_scope sc(stPngRead,0,true); r=png_read(path); sc.add_bytes(r.px.size()); }
+  { stat_scope sc(stQrDecode,0,true); raw=decode_qr(r); sc.add_bytes(raw.size()); }
+  return chunkfmt::parse((const uint8_t*)raw.data(),raw.size(),cv) && cv.h.kind==kind;
+}
+static std::string code_png(const std::string& dir,const char* pattern,int i){
+  char fn[64]; std::snprintf(fn,sizeof(fn),pattern,i); return (std::filesystem::path(dir)/fn).string();
 }
 
-// ---------------- QR decode ----------------
-static std::string decode_qr(const std::string& path){
-  int w=0,h=0; auto rgba=png_rgba(path,w,h);
-  ZXing::ImageView iv(rgba.data(),w,h,ZXing::ImageFormat::RGBA);
-  ZXing::ReaderOptions opts; opts.setFormats(ZXing::BarcodeFormat::QRCode);
-  auto res = ZXing::ReadBarcode(iv, opts);
-  return res.isValid()? res.text() : "";
+// Restores `want` (a file, or every file under a directory) into outdir; returns the file count.
+static int extract_files(const std::string& indir,const std::string& outdir,const std::string& want,key_cache& keys,unsigned nthreads){
+  namespace fs=std::filesystem;
+  std::fprintf(stdout,"STEP #1 read manifest & index ... ");
+  std::string raw; chunkfmt::chunk_view cv;
+  bool haveMeta=false;   // any readable copy will do
+  for(int c=0;c<chunkfmt::kManifestCopies && !haveMeta;c++)
+    try{ haveMeta=read_v2((fs::path(indir)/chunkfmt::manifest_png(c)).string(),chunkfmt::kManifest,raw,cv); }catch(const std::exception&){}
+  if(!haveMeta){ std::fprintf(stdout,"[0]\n"); throw std::runtime_error("No manifest code (qr-manifest.png)"); }
+  const auto m=chunkfmt::manifest::parse(cv.body,cv.size);
+  const int total=(int)cv.h.total;
+  if(m.layout!=indexed::kLayoutIndexed) throw std::runtime_error("--extract needs an indexed archive (encode with --indexed)");
+  if(m.segment<1 || m.chunkSize<1) throw std::runtime_error("Bad segment size");
+  std::vector<uint8_t> sealed; int parts=1;
+  for(int p=0;p<parts;p++){
+    if(!read_v2(code_png(indir,"qr-index-%06d.png",p),chunkfmt::kIndex,raw,cv) || (int)cv.h.index!=p || cv.h.total<1 || (p && (int)cv.h.total!=parts))
+      throw std::runtime_error("Missing index code "+std::to_string(p));
+    parts=(int)cv.h.total; sealed.insert(sealed.end(),cv.body,cv.body+cv.size);
+  }
+  archive_meta a; a.salt=m.salt; a.keySalt=m.keySalt;
+  const auto key=keys.key(a);
+  std::vector<indexed::toc_entry> toc;
+  try{ stat_scope sc(stDecrypt,sealed.size()); toc=indexed::open_toc(key,m.nonce,sealed); }
+  catch(const std::exception& e){ throw std::runtime_error(std::string("Decrypt failed (wrong password or damaged codes): ")+e.what()); }
+  std::fprintf(stdout,"[%d] (%zu files)\n",parts+1,toc.size());
+
+  // The path itself, or everything under it.
+  std::string under=want; if(under.empty() || under.back()!='/') under+='/';
+  std::vector<const indexed::toc_entry*> pick;
+  for(const auto& e:toc) if(e.name==want || e.name.rfind(under,0)==0) pick.push_back(&e);
+  if(pick.empty()) throw std::runtime_error("Not in archive: "+want);
+
+  const int window=(int)nthreads*gzqr_config::kQueuedChunksPerJob;
+  std::fprintf(stdout,"STEP #2 read & decrypt ... (%zu files, jobs=%u)\n",pick.size(),nthreads);
+  worker_pool pool(nthreads,(size_t)window);
+  const uint64_t cs=m.chunkSize; int read=0;
+  for(const auto* e:pick){
+    fs::path rel(e->name);
+    if(rel.is_absolute() || std::find(rel.begin(),rel.end(),fs::path(".."))!=rel.end()) throw std::runtime_error("Unsafe path in index: "+e->name);
+    fs::path out=fs::path(outdir)/rel; fs::create_directories(out.parent_path());
+    try{
+      file_sink f(out.string()); indexed::entry_sink rd(key,m.nonce,m.segment,*e,f);
+      const int c0=(int)(e->begin/cs), c1=e->end>e->begin?(int)((e->end-1)/cs):c0-1;
+      if(c1>=total) throw std::runtime_error("Index entry doesn't match the archive: "+e->name);
+      for(int c=c0;c<=c1;c+=window){
+        const int n=std::min(window,c1-c+1);
+        std::vector<std::vector<uint8_t>> got((size_t)n);
+        for(int k=0;k<n;k++) pool.submit([&,k]{
+          std::string r; chunkfmt::chunk_view v;
+          if(read_v2(code_png(indir,"qr-%06d.png",c+k),chunkfmt::kData,r,v) && (int)v.h.index==c+k) got[k].assign(v.body,v.body+v.size);
+        });
+        pool.wait();
+        for(int k=0;k<n;k++){
+          if(got[k].empty()) throw std::runtime_error("Missing chunk "+std::to_string(c+k)+(m.parityK?" (a full decode can rebuild it from parity)":""));
+          const uint64_t at=(uint64_t)(c+k)*cs, lo=std::max(at,e->begin), hi=std::min(at+got[k].size(),e->end);
+          if(hi<=lo) throw std::runtime_error("Index entry doesn't match the archive: "+e->name);
+          stat_scope sc(stDecrypt,hi-lo); rd.write(got[k].data()+(lo-at),(size_t)(hi-lo));
+        }
+        read+=n;
+      }
+      rd.finish();
+    }catch(...){ std::error_code ec; fs::remove(out,ec); throw; }
+    std::fprintf(stdout,"   %s (%llu bytes)\n",e->name.c_str(),(unsigned long long)e->size);
+  }
+  std::fprintf(stdout,"   %d of %d data codes read\n",read,total);
+  return (int)pick.size();
+}
+
+// ---------------- Batch ----------------
+/*
+ * One archive of a batch (a subdirectory of the input). Scan jobs hold a
+ * reference; the last one out verifies and reports it, and the output file
+ * is closed as soon as the archive is done. A failing archive is reported
+ * and the others carry on.
+ */
+struct batch_item {
+  std::string name; stream_assembler table;
+  std::atomic<int> refs{1}; std::atomic<bool> failed{false};
+  std::mutex em; std::string err;
+  std::function<void(batch_item&)> onDone;
+  batch_item(std::string n,const std::string& outdir,key_cache& keys):name(std::move(n)),table(outdir,keys){}
+  void fail(const std::string& e){ std::lock_guard<std::mutex> lk(em); if(!failed.exchange(true)) err=e; }
+  void release(){
+    if(--refs) return;
+    if(!failed){ try{ table.finish(); }catch(const std::exception& e){ fail(e.what()); } }
+    if(onDone) onDone(*this);
+  }
+};
+
+static int decode_batch(const std::string& indir,const std::string& outdir,key_cache& keys,unsigned nthreads){
+  std::vector<std::string> dirs;
+  for(auto& e: std::filesystem::directory_iterator(indir)) if(e.is_directory()) dirs.push_back(e.path().filename().string());
+  std::sort(dirs.begin(),dirs.end());
+  if(dirs.empty()) throw std::runtime_error("Batch has no archive directories");
+  std::fprintf(stdout,"STEP #2 scan & decrypt ... (batch of %zu, jobs=%u)\n",dirs.size(),nthreads);
+
+  std::mutex outMu; std::atomic<int> done{0}, bad{0}; const int n=(int)dirs.size();
+  worker_pool pool(nthreads,(size_t)nthreads*gzqr_config::kQueuedChunksPerJob);
+  for(const auto& d:dirs){
+    std::string out=(std::filesystem::path(outdir)/d).string();
+    std::filesystem::create_directories(out);
+    auto item=std::make_shared<batch_item>(d,out,keys);
+    item->onDone=[&done,&bad,&outMu,n](batch_item& it){
+      int k=++done; if(it.failed) bad++;
+      std::lock_guard<std::mutex> lk(outMu);
+      if(it.failed) std::fprintf(stdout,"   [%d/%d] %s: Error: %s\n",k,n,it.name.c_str(),it.err.c_str());
+      else std::fprintf(stdout,"   [%d/%d] %s → %s\n",k,n,it.name.c_str(),it.table.out_path().c_str());
+    };
+    for(auto& f:list_pngs((std::filesystem::path(indir)/d).string())){
+      item->refs++;
+      pool.submit([item,f]{
+        if(!item->failed){ try{ scan_file(f,item->table,nullptr); }catch(const std::exception& e){ item->fail(e.what()); } }
+        item->release();
+      });
+    }
+    item->release();
+  }
+  pool.wait();
+  std::printf("\n✅ Restored %d of %d archives → %s\n",n-bad.load(),n,outdir.c_str());
+  return bad?1:0;
 }
 
 // ---------------- Main ----------------
 int main(int argc, char** argv){
-  if(argc<2){ std::fprintf(stderr,"Usage: MakeDecode <qrs_dir> [out_dir]\n"); return 2; }
+  std::vector<std::string> args; int jobs=gzqr_config::kDefaultJobs; bool showStats=false, batch=false; std::string statsJson, frames, extract;
+  int rawW=0, rawH=0;
+  for(int a=1;a<argc;a++){
+    std::string s=argv[a];
+    if((s=="--jobs"||s=="-j") && a+1<argc) jobs=std::atoi(argv[++a]);
+    else if(s.rfind("--jobs=",0)==0) jobs=std::atoi(s.c_str()+7);
+    else if(s=="--batch") batch=true;
+    else if(s=="--frames" && a+1<argc) frames=argv[++a];
+    else if(s=="--extract" && a+1<argc) extract=argv[++a];
+    else if(s=="--raw" && a+1<argc){ if(std::sscanf(argv[++a],"%dx%d",&rawW,&rawH)!=2 || rawW<=0 || rawH<=0){ std::fprintf(stderr,"--raw expects WxH\n"); return 2; } }
+    else if(s=="--stats") showStats=true;
+    else if(s=="--stats-json" && a+1<argc) statsJson=argv[++a];
+    else if(s.rfind("--stats-json=",0)==0) statsJson=s.substr(13);
+    else args.push_back(s);
+  }
+  // With --frames the input is the recording, so out_dir is the only positional argument.
+  if(!frames.empty()) args.insert(args.begin(),frames);
+  if(args.empty() || (batch && !frames.empty()) || (!extract.empty() && (batch || !frames.empty()))){
+    std::fprintf(stderr,"Usage: MakeDecode <qrs_dir> [out_dir] [--batch] [--jobs N] [--stats] [--stats-json FILE]\n"
+                        "       MakeDecode --frames <video.y4m|-> [out_dir] [--raw WxH] [--jobs N]\n"
+                        "       MakeDecode <qrs_dir> [out_dir] --extract <path/in/archive> [--jobs N]\n"); return 2; }
+  if(showStats || !statsJson.empty()) stats().enable();
   try{
-    std::string indir=argv[1], outdir=(argc>=3?argv[2]:"out");
+    std::string indir=args[0], outdir=(args.size()>=2?args[1]:"out");
     std::filesystem::create_directories(outdir);
 
-    std::fprintf(stdout,"STEP #1 collect data ... ");
-    std::vector<std::string> files;
-    for(auto& e: std::filesystem::directory_iterator(indir))
-      if(e.is_regular_file() && e.path().extension()==".png") files.push_back(e.path().string());
-    if(files.empty()){ std::fprintf(stdout,"[0]\n"); throw std::runtime_error("No QR images"); }
-    std::fprintf(stdout,"[%zu]\n",files.size());
-
-    std::string nameBase="restored", metaExt, cipherSha;
-    std::vector<uint8_t> salt, nonce;
-    int expectedTotal=-1, chunkSize=0;
-    std::map<int,std::vector<uint8_t>> chunks;
-
-    for(auto& f: files){
-      auto txt=decode_qr(f); if(txt.empty()) continue;
-      auto j=value::parse(txt);
-      if(!j.contains("type")) continue;
-      if(j["type"].get<std::string>()!=std::string(gzqr_config::kProjectName)+"-CHUNK-ENC") continue;
-
-      int chunk=(int)j["chunk"].get<double>();
-      int total=(int)j["total"].get<double>();
-      auto data=b64d(j["dataB64"].get<std::string>());
-      if(sha256_hex(data)!=j["hash"].get<std::string>()) continue;
-
-      if(expectedTotal<0) expectedTotal=total;
-      if(chunkSize==0) chunkSize=(int)j["chunkSize"].get<double>();
-      if(cipherSha.empty()) cipherSha=j["cipherHash"].get<std::string>();
-      if(salt.empty()) salt=b64d(j["saltB64"].get<std::string>());
-      if(nonce.empty()) nonce=b64d(j["nonceB64"].get<std::string>());
-      if(nameBase=="restored" && j.contains("name")) nameBase=j["name"].get<std::string>();
-      if(metaExt.empty() && j.contains("ext")) metaExt=j["ext"].get<std::string>();
-
-      chunks[chunk]=data;
-      if(gzqr_config::kPrintProgressCounters)
-        std::fprintf(stdout,"   collected chunk %d/%d\n",chunk+1,total);
-    }
-
-    if((int)chunks.size()!=expectedTotal) throw std::runtime_error("Missing chunks");
+    std::string pass = std::getenv("GZQR_PASS") ? std::getenv("GZQR_PASS") : std::string(gzqr_config::kDefaultPassword);
+    if(pass.size()<8) throw std::runtime_error("Password >=8 required");
+    key_cache keys(pass);
+    unsigned nthreads=resolve_jobs(jobs);
 
-    std::string cipherFile=(std::filesystem::temp_directory_path()/ "gzqr-cipher.bin").string();
-    FILE* fc=fopen(cipherFile.c_str(),"wb");
-    for(auto& [i,d]:chunks) fwrite(d.data(),1,d.size(),fc);
-    fclose(fc);
+    if(batch){
+      // Every subdirectory is one archive, restored into out_dir/<subdir>/.
+      int rc=decode_batch(indir,outdir,keys,nthreads);
+      if(showStats) stats().print(stdout);
+      if(!statsJson.empty()) stats().write_json(statsJson,"decode");
+      return rc;
+    }
 
-    if(sha256_hex_file(cipherFile)!=cipherSha) throw std::runtime_error("Global sha256 mismatch");
+    if(!extract.empty()){
+      int n=extract_files(indir,outdir,extract,keys,nthreads);
+      std::printf("\n✅ Extracted %d file%s → %s\n",n,n==1?"":"s",outdir.c_str());
+      if(showStats) stats().print(stdout);
+      if(!statsJson.empty()) stats().write_json(statsJson,"decode");
+      return 0;
+    }
 
-    std::fprintf(stdout,"STEP #3 decrypt ... ");
-    std::string pass = std::getenv("GZQR_PASS") ? std::getenv("GZQR_PASS") : std::string(gzqr_config::kDefaultPassword);
-    if(pass.size()<8) throw std::runtime_error("Password >=8 required");
-    auto key=scrypt_kdf(pass,salt,{(1u<<15),8u,(uint32_t)std::max(1u,std::thread::hardware_concurrency())});
+    stream_assembler table(outdir,keys); std::mutex outMu;
+    if(!frames.empty()) scan_frames(frames,rawW,rawH,table,outMu,nthreads);
+    else{
+      std::fprintf(stdout,"STEP #1 collect data ... ");
+      std::vector<std::string> files=list_pngs(indir);
+      if(files.empty()){ std::fprintf(stdout,"[0]\n"); throw std::runtime_error("No QR images"); }
+      std::fprintf(stdout,"[%zu]\n",files.size());
 
-    std::string outName=(nameBase.empty()?std::string("restored"):nameBase)+(metaExt.empty()?"":metaExt);
-    std::string outPath=(std::filesystem::path(outdir)/outName).string();
-    aes_gcm_decrypt_file_to_path(cipherFile,outPath,key,nonce,{});
-    std::fprintf(stdout,"[1]\nSTEP #4 write output ... [1]\n");
-    std::filesystem::remove(cipherFile);
+      // 2) Scan, verify and decrypt in one pass; the output is removed on failure.
+      std::fprintf(stdout,"STEP #2 scan & decrypt ... (jobs=%u)\n",nthreads);
+      worker_pool pool(nthreads,(size_t)nthreads*gzqr_config::kQueuedChunksPerJob);
+      for(size_t k=0;k<files.size();k++)
+        pool.submit([&,k]{ scan_file(files[k],table,&outMu); });
+      pool.wait();
+    }
+    std::fprintf(stdout,"STEP #3 verify ... ");
+    table.finish();
+    if(table.meta().layout==cdc::kLayoutCdc) std::fprintf(stdout,"[1] (incremental, %d blocks",table.blocks());
+    else if(table.meta().layout==indexed::kLayoutIndexed) std::fprintf(stdout,"[1] (indexed, %u KiB segments",table.meta().segment>>10);
+    else std::fprintf(stdout,"[1] (codec=%s",codec_name(table.meta().codec));
+    if(table.rebuilt()) std::fprintf(stdout,", %d chunks rebuilt from parity",table.rebuilt());
+    std::fprintf(stdout,")\n");
+    std::string outPath=table.out_path();
 
     std::printf("\n✅ Restored file → %s\n", outPath.c_str());
+    if(showStats) stats().print(stdout);
+    if(!statsJson.empty()) stats().write_json(statsJson,"decode");
     return 0;
   }catch(const std::exception& e){
     std::fprintf(stderr,"Error: %s\n",e.what()); return 1;
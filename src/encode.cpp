@@ -3,16 +3,39 @@
  * Author: Daniil V (RestlessByte)[https://github.com/RestlessByte]
  * License: MIT
  *
- * Archives (if a directory), encrypts via AES-256-GCM (key from scrypt),
- * splits the encrypted bytes into multiple QR code PNGs.
+ * Archives (if a directory), compresses, encrypts via AES-256-GCM (key from
+ * scrypt), splits the encrypted bytes into multiple QR code PNGs. With the
+ * binary format this is one streaming pass: archiver → compressor →
+ * encryptor → chunker → QR workers, with no temporary files. Optional
+ * parity codes (erasure.hpp) are computed on the fly, one group at a time.
+ * --incremental cuts the input into content-defined blocks (cdc.hpp) and
+ * renders only the blocks an earlier run left no codes for. --indexed seals
+ * the input in segments and adds a table of contents (indexed.hpp), so
+ * MakeDecode --extract can restore one file from a few codes.
  *
- * IMPORTANT: Chunk sizing is calibrated against the ACTUAL JSON payload
- * (including base64 + metadata), so "Payload > QR capacity" won't happen.
+ * IMPORTANT: Chunk sizing is calibrated against the ACTUAL payload (binary
+ * header, or JSON + base64 + metadata for --format json), so
+ * "Payload > QR capacity" won't happen.
  */
 
 #include "common.hpp"
 #include "config.hpp"
-#include "third_party/json.hpp"
+#include "pool.hpp"
+#include "chunk_format.hpp"
+#include "qr_capacity.hpp"
+#include "png_writer.hpp"
+#include "stream.hpp"
+#include "zip_writer.hpp"
+#include "compress.hpp"
+#include "stats.hpp"
+#include "sheet.hpp"
+#include "planes.hpp"
+#include "frames.hpp"
+#include "erasure.hpp"
+#include "archive_writer.hpp"
+#include "cdc.hpp"
+#include "indexed.hpp"
+#include "chunk_json.hpp"
 
 #include <filesystem>
 #include <thread>
@@ -21,11 +44,14 @@
 #include <map>
 #include <vector>
 #include <algorithm>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <set>
 #include <qrencode.h>
-#include <png.h>
 
 using namespace gzqr;
-using mini_json::value;
 
 // ---------------- Helpers ----------------
 static bool is_dir(const std::string& p){ return std::filesystem::is_directory(p); }
@@ -40,181 +66,564 @@ static int qr_ecl(){
   switch(c){ case 'L': return QR_ECLEVEL_L; case 'M': return QR_ECLEVEL_M; case 'H': return QR_ECLEVEL_H; default: return QR_ECLEVEL_Q; }
 }
 
-// ---------------- Zip input ----------------
-// NOTE: when input is a directory, we (cd) into it and zip "." so the ZIP root
-// contains only the directory contents (no "home/.../folder/" prefix).
-static std::string materialize_data(const std::string& input,std::string& nameBase,std::string& metaExt){
+// ---------------- Input ----------------
+// Directories become "<dir>.zip" with paths relative to the directory (no
+// "home/.../folder/" prefix); files keep their own name and extension.
+static void describe_input(const std::string& input,std::string& nameBase,std::string& metaExt){
+  auto p=std::filesystem::path(input);
   if(is_dir(input)){
-    auto p=std::filesystem::path(input);
     std::string base=p.filename().string();
     if(base.empty()) base=p.parent_path().filename().string();
     nameBase=base;
     metaExt=".zip";
-
-    std::string out=tmpfile("gzqr-")+".zip";
-    std::string cmd = std::string("(cd '") + input + "' && zip -r -q '" + out + "' .)";
-    if(std::system(cmd.c_str())!=0) throw std::runtime_error("zip failed (install zip)");
-    return out;
   } else {
-    auto p=std::filesystem::path(input);
     metaExt=p.has_extension()?p.extension().string():"";
     nameBase=metaExt.empty()?p.filename().string():p.stem().string();
-    return input;
   }
 }
+// `members` (indexed archives): files and where they start in the stream. A
+// plain file is one member at offset 0; its size is filled in by the caller.
+static void produce_input(const std::string& input,byte_sink& out,std::vector<zip_member>* members=nullptr){
+  if(is_dir(input)){ zip_directory(input,out,members); return; }
+  if(members) *members={{std::filesystem::path(input).filename().string(),0,0}};
+  stream_file(input,out);
+}
+
+// ---------------- Capacity ----------------
+/*
+ * JSON format: the per-code metadata is everything except the base64 data,
+ * measured once with worst-case numbers and the real name/ext, then handed
+ * to the closed-form capacity model (no trial encodes).
+ */
+static int max_data_bytes_per_chunk(int version,int ecl,
+                                    const std::string& nameBase,
+                                    const std::string& metaExt,
+                                    bool keySalt)
+{
+  const std::string type=std::string(gzqr_config::kProjectName)+"-CHUNK-ENC", hash(64,'0');
+  const std::string salt=b64(std::vector<uint8_t>(16)), nonce=b64(std::vector<uint8_t>(12));
+  chunkjson::fields f;
+  f.type=type; f.version=gzqr_config::kProjectVersion;
+  f.chunk=f.total=f.chunkSize=999999;
+  f.cipherHash=hash; f.saltB64=salt; f.nonceB64=nonce;
+  if(keySalt) f.keySaltB64=salt;
+  f.name=nameBase; f.ext=metaExt; f.codec="deflate";
+  std::string meta; chunkjson::write(meta,f,nullptr,0);
+  return chunk_capacity(version, ecl, meta.size(), true);
+}
+
+// Binary format: only the fixed header rides along.
+static int max_bin_bytes_per_chunk(int version,int ecl){
+  return chunk_capacity(version, ecl, chunkfmt::kHeaderSize, false);
+}
+
+// ---------------- Chunk job ----------------
+// Everything that is identical for all chunks of one archive.
+struct chunk_ctx {
+  std::string outdir, cipherSha, saltB64, nonceB64, keySaltB64, nameBase, metaExt, codec;
+  int total=0, chunkSize=0, ecl=0, version=0, margin=0, scale=0;
+  bool binary=true;
+  png_opts png;
+  sheet_writer* sheets=nullptr;   // --sheet: codes are tiled instead of one PNG each
+  sheet_writer* paritySheets=nullptr;
+  plane_writer* planes=nullptr;   // --rgb: three codes per image, one per colour channel
+  plane_writer* parityPlanes=nullptr;
+  y4m_writer* frames=nullptr;     // --frames: every code is a video frame instead (stream order)
+};
+
+// Each payload is encoded exactly once; the capacity model guarantees the fit.
+static QRcode* encode_code(const chunk_ctx& c,const uint8_t* data,size_t n){
+  stat_scope sc(stQrEncode,n,true);
+  QRcode* q=QRcode_encodeData((int)n,data,c.version,(QRecLevel)c.ecl);
+  if(!q) throw std::runtime_error("Internal error: calibrated payload did not fit");
+  return q;
+}
+static void write_code(const chunk_ctx& c,const std::string& fn,const uint8_t* data,size_t n){
+  QRcode* q=encode_code(c,data,n);
+  try{
+    stat_scope sc(stPngWrite,n,true);
+    if(c.frames) c.frames->place_meta(q->data,q->width);   // manifest; data and parity go through emit_code
+    else write_qr_png((std::filesystem::path(c.outdir)/fn).string(),q->data,q->width,c.margin,c.scale,c.png);
+  }
+  catch(...){ QRcode_free(q); throw; }
+  QRcode_free(q);
+}
+
+// Code #i of `kind`: its own PNG (`pattern`), a video frame, a cell on a sheet or a colour plane.
+static void emit_code(const chunk_ctx& c,uint8_t kind,sheet_writer* sheets,plane_writer* planes,const char* pattern,int i,const uint8_t* data,size_t n){
+  if(c.frames){ QRcode* q=encode_code(c,data,n); stat_scope sc(stPngWrite,n,true);
+    try{ c.frames->place(kind,i,q->data,q->width); }catch(...){ QRcode_free(q); throw; }
+    QRcode_free(q); return; }
+  if(sheets){ QRcode* q=encode_code(c,data,n); stat_scope sc(stPngWrite,n); sheets->place(i,q); return; }
+  if(planes){ QRcode* q=encode_code(c,data,n); stat_scope sc(stPngWrite,n); planes->place(i,q); return; }
+  char fn[64]; std::snprintf(fn,sizeof(fn),pattern,i);
+  write_code(c,fn,data,n);
+}
+static void emit_chunk_code(const chunk_ctx& c,int i,const uint8_t* data,size_t n){ emit_code(c,chunkfmt::kData,c.sheets,c.planes,"qr-%06d.png",i,data,n); }
+
+// Parity code #i (group*K + row); always chunkSize bytes.
+static void encode_parity(const chunk_ctx& c,int i,const std::vector<uint8_t>& par){
+  chunkfmt::header h; h.kind=chunkfmt::kParity; h.index=(uint32_t)i;
+  if(c.parityPlanes) h.flags=plane_flags(i%kPlanes);
+  std::vector<uint8_t> payload;
+  { stat_scope sc(stChunkBuild,par.size()); payload=chunkfmt::build(h,par.data(),par.size()); }
+  emit_code(c,chunkfmt::kParity,c.paritySheets,c.parityPlanes,"qr-parity-%06d.png",i,payload.data(),payload.size());
+}
+
+// Builds the payload for chunk #i and emits its code.
+// Pure function of (ctx, i, data) so workers can run it in any order.
+static void encode_chunk(const chunk_ctx& c,int i,const std::vector<uint8_t>& view){
+  if(c.binary){
+    chunkfmt::header h; h.kind=chunkfmt::kData; h.index=(uint32_t)i; h.total=(uint32_t)c.total;
+    if(c.planes) h.flags=plane_flags(i%kPlanes);
+    std::vector<uint8_t> payload;
+    { stat_scope sc(stChunkBuild,view.size()); payload=chunkfmt::build(h,view.data(),view.size()); }
+    emit_chunk_code(c,i,payload.data(),payload.size());
+    return;
+  }
+  stat_scope sc(stChunkBuild,view.size());
+  static const std::string type=std::string(gzqr_config::kProjectName)+"-CHUNK-ENC";
+  chunkjson::fields f;
+  f.type=type; f.version=gzqr_config::kProjectVersion;
+  f.chunk=i; f.total=c.total; f.chunkSize=c.chunkSize;
+  f.cipherHash=c.cipherSha; f.saltB64=c.saltB64; f.nonceB64=c.nonceB64; f.keySaltB64=c.keySaltB64;
+  f.name=c.nameBase; f.ext=c.metaExt;
+  if(c.codec!="none") f.codec=c.codec;
+  thread_local std::string payload;   // reused: no allocation once it has grown to a chunk
+  chunkjson::write(payload,f,view.data(),view.size());
+  sc.stop();
+  emit_chunk_code(c,i,(const uint8_t*)payload.data(),payload.size());
+}
+
+// ---------------- Code parts ----------------
+// Splits `data` into codes of `kind` (index = part, total = parts); each body
+// is `prefix` + a slice. Incremental blocks and recipes, and indexed archives'
+// table of contents.
+static std::vector<std::vector<uint8_t>> part_codes(uint8_t kind,const std::vector<uint8_t>& prefix,const std::vector<uint8_t>& data,size_t chunkSize){
+  size_t cap=chunkSize-prefix.size(); int parts=(int)std::max<size_t>(1,(data.size()+cap-1)/cap);
+  std::vector<std::vector<uint8_t>> out;
+  for(int p=0;p<parts;p++){
+    size_t off=(size_t)p*cap, n=std::min(cap,data.size()-off);
+    std::vector<uint8_t> body(prefix); body.insert(body.end(),data.begin()+off,data.begin()+off+n);
+    chunkfmt::header h; h.kind=kind; h.index=(uint32_t)p; h.total=(uint32_t)parts;
+    out.push_back(chunkfmt::build(h,body.data(),body.size()));
+  }
+  return out;
+}
+
+// ---------------- Archive job ----------------
+// Settings shared by every archive of a run.
+struct run_opts {
+  std::string format, sheet;
+  std::string frames; FILE* framesOut=nullptr;   // --frames: Y4M path, and its stream (see main)
+  compress_opts comp; png_opts png; parity_opts par;
+  bool rgb=false;                        // --rgb
+  bool indexed=false;                    // --indexed
+  unsigned jobs=1; int binChunkSize=0;   // binary chunk size, calibrated once per run
+  bool verbose=true;                     // single input: STEP lines and per-chunk progress
+};
+// Key material of one archive. A single input uses scrypt(pass, salt)
+// directly; batch runs derive scrypt once and give each archive its own
+// HKDF salt, so every archive still has a unique key and nonce.
+struct archive_keys { std::vector<uint8_t> key, salt, keySalt, nonce; };
+
+/*
+ * One input being encoded. Queued jobs hold a reference. Whoever drops the
+ * last one (a worker, or the producer once the input is through) writes the
+ * partial sheets and the manifest, so a batch never waits on one archive's
+ * tail before starting the next.
+ */
+struct archive_job {
+  chunk_ctx ctx;
+  std::unique_ptr<sheet_writer> sheets, paritySheets;
+  std::unique_ptr<plane_writer> planes, parityPlanes;
+  std::unique_ptr<y4m_writer> frames;
+  std::vector<std::vector<uint8_t>> manifests;   // binary format: one payload per manifest copy
+  std::vector<std::vector<uint8_t>> index;   // --indexed: qr-index-*.png payloads
+  std::atomic<int> refs{1}, written{0};
+  int total=0, parityCodes=0;
+  std::function<void(archive_job&)> onDone;
+
+  void acquire(){ refs++; }
+  void release(){
+    if(--refs) return;
+    if(sheets) sheets->finish();
+    if(paritySheets) paritySheets->finish();
+    if(planes) planes->finish();
+    if(parityPlanes) parityPlanes->finish();
+    for(size_t p=0;p<index.size();p++){ char fn[64]; std::snprintf(fn,sizeof(fn),"qr-index-%06zu.png",p); write_code(ctx,fn,index[p].data(),index[p].size()); }
+    for(size_t c=0;c<manifests.size();c++) write_code(ctx,chunkfmt::manifest_png((int)c),manifests[c].data(),manifests[c].size());
+    if(frames) frames->finish();
+    if(onDone) onDone(*this);
+  }
+};
 
-// ---------------- PNG writer ----------------
-static void write_qr_png(const std::string& out,QRcode* qrcode,int margin,int scale){
-  if(!qrcode) throw std::runtime_error("QRcode is null");
-  const int qsize=qrcode->width;
-  const int img_size=(qsize+2*margin)*scale;
-  std::vector<uint8_t> rgba((size_t)img_size*img_size*4,0xFF);
-  auto set_px=[&](int x,int y,uint8_t v){
-    if(x<0||y<0||x>=img_size||y>=img_size) return;
-    size_t off=((size_t)y*img_size+x)*4;
-    rgba[off]=v; rgba[off+1]=v; rgba[off+2]=v; rgba[off+3]=0xFF;
+// Streams `input` into codes under `outdir`; the returned job completes on the pool.
+static std::shared_ptr<archive_job> encode_archive(const std::string& input,const std::string& outdir,const run_opts& o,
+                                                   const archive_keys& k,worker_pool& pool,std::mutex& outMu){
+  auto job=std::make_shared<archive_job>();
+  chunk_ctx& ctx=job->ctx;
+  std::string nameBase,metaExt; describe_input(input,nameBase,metaExt);
+  if(o.frames.empty()) std::filesystem::create_directories(outdir);
+  ctx.outdir=outdir; ctx.saltB64=b64(k.salt); ctx.nonceB64=b64(k.nonce);
+  if(!k.keySalt.empty()) ctx.keySaltB64=b64(k.keySalt);
+  ctx.nameBase=nameBase; ctx.metaExt=metaExt;
+  ctx.ecl=qr_ecl(); ctx.version=qr_version(); ctx.margin=qr_margin(); ctx.scale=qr_scale();
+  ctx.binary=(o.format=="bin"); ctx.png=o.png;
+  int chunk_size = ctx.binary ? o.binChunkSize
+                              : max_data_bytes_per_chunk(ctx.version,ctx.ecl,nameBase,metaExt,!k.keySalt.empty());
+  if(chunk_size < 64) chunk_size = 64;
+  ctx.chunkSize=chunk_size;
+  const parity_opts& par=o.par;
+  if(par.on() && !ctx.binary) throw std::runtime_error("--parity needs --format bin");
+  if(!o.sheet.empty()){
+    sheet_layout L;
+    if(!parse_sheet(o.sheet,ctx.scale,L)) throw std::runtime_error("--sheet expects NxM (each at most 255) or a4");
+    if(ctx.version<=0) throw std::runtime_error("Sheet mode needs a fixed QR version");
+    job->sheets=std::make_unique<sheet_writer>(L,17+4*ctx.version,outdir,o.png);
+    ctx.sheets=job->sheets.get();
+    if(par.on()){ job->paritySheets=std::make_unique<sheet_writer>(L,17+4*ctx.version,outdir,o.png,"qr-sheet-p"); ctx.paritySheets=job->paritySheets.get(); }
+  }
+  if(o.rgb){
+    if(!ctx.binary) throw std::runtime_error("--rgb needs --format bin");
+    if(!o.sheet.empty()) throw std::runtime_error("--rgb and --sheet can't be combined");
+    if(ctx.version<=0) throw std::runtime_error("RGB mode needs a fixed QR version");
+    job->planes=std::make_unique<plane_writer>(17+4*ctx.version,ctx.margin,ctx.scale,outdir,o.png);
+    ctx.planes=job->planes.get();
+    if(par.on()){ job->parityPlanes=std::make_unique<plane_writer>(17+4*ctx.version,ctx.margin,ctx.scale,outdir,o.png,"qr-rgb-p"); ctx.parityPlanes=job->parityPlanes.get(); }
+  }
+  if(o.indexed){
+    // --extract finds a chunk by its file name, so every code needs its own PNG.
+    if(!ctx.binary) throw std::runtime_error("--indexed needs --format bin");
+    if(!o.sheet.empty() || o.rgb || !o.frames.empty()) throw std::runtime_error("--indexed can't be combined with --sheet, --rgb or --frames");
+  }
+  if(!o.frames.empty()){
+    if(!o.sheet.empty() || o.rgb) throw std::runtime_error("--frames can't be combined with --sheet or --rgb");
+    if(ctx.version<=0) throw std::runtime_error("Frame output needs a fixed QR version");
+    job->frames=std::make_unique<y4m_writer>(o.framesOut,17+4*ctx.version,ctx.margin,ctx.scale,gzqr_config::kFrameRate,
+                                             ctx.binary?chunkfmt::kManifestCopies:0,ctx.binary?gzqr_config::kFrameManifestEvery:0);
+    ctx.frames=job->frames.get();
+  }
+
+  const bool verbose=o.verbose;
+  auto submit=[&](int i,std::vector<uint8_t> view){
+    if(job->frames) job->frames->expect(chunkfmt::kData,i);
+    job->acquire();
+    pool.submit([job,&outMu,verbose,i,view=std::move(view)]{
+      encode_chunk(job->ctx,i,view);
+      int n=++job->written;
+      if(verbose && gzqr_config::kPrintProgressCounters){
+        std::lock_guard<std::mutex> lk(outMu);
+        if(job->ctx.total>0) std::fprintf(stdout,"   chunk %d/%d written\n",n,job->ctx.total);
+        else std::fprintf(stdout,"   chunk %d written\n",n);
+      }
+      job->release();
+    });
   };
-  const unsigned char* data=qrcode->data;
-  for(int my=0;my<qsize;++my){
-    for(int mx=0;mx<qsize;++mx){
-      bool dark=(data[my*qsize+mx]&1)!=0;
-      uint8_t v=dark?0:255;
-      int px0=(margin+mx)*scale,py0=(margin+my)*scale;
-      for(int dy=0;dy<scale;dy++) for(int dx=0;dx<scale;dx++) set_px(px0+dx,py0+dy,v);
+
+  if(ctx.binary){
+    // 3) Archive → encrypt → chunk → QR in one pass. The chunk count isn't
+    // known until the stream ends, so data headers carry total=0 and the
+    // manifest (written last) is authoritative.
+    if(verbose){
+      std::fprintf(stdout,"STEP #3 encrypt & encode QR ... (format=%s chunkSize=%d jobs=%u",o.format.c_str(),chunk_size,o.jobs);
+      if(par.on()) std::fprintf(stdout," parity=%d+%d %s",par.n,par.k,gf::active().name);
+      if(o.indexed) std::fprintf(stdout," indexed, %d KiB segments",gzqr_config::kIndexSegmentSize>>10);
+      std::fprintf(stdout,")\n");
+    }
+    // Parity codes go to the pool as soon as their group's last data chunk has.
+    archive_writer w(o.comp,par,(size_t)chunk_size,k.key,k.nonce,[&](uint8_t kind,int i,std::vector<uint8_t> body){
+      if(kind==chunkfmt::kData){ submit(i,std::move(body)); return; }
+      if(job->frames) job->frames->expect(chunkfmt::kParity,i);
+      job->parityCodes++; job->acquire();
+      pool.submit([job,i,p=std::move(body)]{ encode_parity(job->ctx,i,p); job->release(); });
+    },o.indexed?(size_t)gzqr_config::kIndexSegmentSize:0);
+    std::vector<zip_member> members;
+    { stat_scope sc(stInput); produce_input(input,w,o.indexed?&members:nullptr); }
+    w.finish();
+    job->total=w.chunks();
+    if(o.indexed){
+      // Table of contents: sealed as one more record, split into 'I' codes.
+      if(!is_dir(input)) members[0].size=w.segments()->bytes();
+      auto toc=indexed::seal_toc(k.key,k.nonce,indexed::make_toc(members,*w.segments()));
+      job->index=part_codes(chunkfmt::kIndex,{},toc,(size_t)chunk_size);
     }
+
+    chunkfmt::manifest m=w.manifest();
+    m.salt=k.salt; m.keySalt=k.keySalt; m.name=nameBase; m.ext=metaExt;
+    for(int c=0;c<chunkfmt::kManifestCopies;c++) job->manifests.push_back(manifest_code(m,job->total,c));
+    if((int)job->manifests[0].size()>qr_byte_capacity(ctx.version,ctx.ecl)) throw std::runtime_error("Name too long for manifest code");
+  } else {
+    // 3) Legacy JSON codes repeat the ciphertext hash and total in every
+    // code, so the ciphertext is spooled once before chunking.
+    if(verbose) std::fprintf(stdout,"STEP #3 encrypt ... ");
+    std::string encPath=tmpfile("payload-")+".enc";
+    { file_sink spool(encPath); stat_sink spoolStat(stChunker,spool);
+      gcm_encrypt_sink enc(k.key,k.nonce,{},spoolStat); stat_sink encStat(stEncrypt,enc);
+      compress_sink zc(o.comp,encStat); stat_sink zcStat(stCompress,zc);
+      { stat_scope sc(stInput); produce_input(input,zcStat); }
+      zcStat.finish(); ctx.codec=codec_name(zc.codec()); }
+    ctx.cipherSha=sha256_hex_file(encPath); if(verbose) std::fprintf(stdout,"[1]\n");
+
+    FILE* f=fopen(encPath.c_str(),"rb"); if(!f) throw std::runtime_error("open enc");
+    fseek(f,0,SEEK_END); long sz=ftell(f); fseek(f,0,SEEK_SET);
+    job->total=(int)((sz+chunk_size-1)/chunk_size); ctx.total=job->total;
+    if(verbose) std::fprintf(stdout,"STEP #4 chunk & encode QR ... (format=%s chunkSize=%d total=%d jobs=%u)\n",o.format.c_str(),chunk_size,job->total,o.jobs);
+    try{
+      for(int i=0;i<job->total;i++){
+        std::vector<uint8_t> view((size_t)chunk_size);
+        view.resize(fread(view.data(),1,view.size(),f));
+        submit(i,std::move(view));
+      }
+    }catch(...){ fclose(f); std::filesystem::remove(encPath); throw; }
+    fclose(f); std::filesystem::remove(encPath);
   }
-  FILE* fp=fopen(out.c_str(),"wb"); if(!fp) throw std::runtime_error("open png");
-  png_structp png_ptr=png_create_write_struct(PNG_LIBPNG_VER_STRING,nullptr,nullptr,nullptr);
-  png_infop info_ptr=png_create_info_struct(png_ptr);
-  if(setjmp(png_jmpbuf(png_ptr))){ png_destroy_write_struct(&png_ptr,&info_ptr); fclose(fp); throw std::runtime_error("png write"); }
-  png_init_io(png_ptr,fp);
-  png_set_IHDR(png_ptr,info_ptr,img_size,img_size,8,PNG_COLOR_TYPE_RGBA,PNG_INTERLACE_NONE,PNG_COMPRESSION_TYPE_DEFAULT,PNG_FILTER_TYPE_DEFAULT);
-  png_write_info(png_ptr,info_ptr);
-  std::vector<png_bytep> rows(img_size); for(int y=0;y<img_size;y++) rows[y]=(png_bytep)&rgba[(size_t)y*img_size*4];
-  png_write_image(png_ptr,rows.data()); png_write_end(png_ptr,nullptr);
-  png_destroy_write_struct(&png_ptr,&info_ptr); fclose(fp);
+  return job;
 }
 
-// ---------------- Capacity probing ----------------
-static bool payload_fits(const std::string& payload,int version,int ecl){
-  QRcode* q=QRcode_encodeData((int)payload.size(),(const unsigned char*)payload.data(),version,(QRecLevel)ecl);
-  if(!q) return false; QRcode_free(q); return true;
-}
+// ---------------- Incremental ----------------
+static std::string recipe_png(int i){ char fn[64]; std::snprintf(fn,sizeof(fn),"qr-recipe-%06d.png",i); return fn; }
 
 /*
- * Realistic capacity calibration:
- * Build payload identical to real one and probe the QR capacity.
+ * --incremental (cdc.hpp): renders only the blocks `idx` has no codes for,
+ * writes a new recipe and manifest, then deletes the codes of blocks the
+ * new recipe no longer uses and saves the index.
  */
-static int max_data_bytes_per_chunk(int version,int ecl,
-                                    const std::string& nameBase,
-                                    const std::string& metaExt)
+static void encode_incremental(const std::string& input,const std::string& outdir,const run_opts& o,
+                               const std::vector<uint8_t>& key,const std::vector<uint8_t>& salt,
+                               cdc::block_index& idx,worker_pool& pool,std::mutex& outMu)
 {
-  const std::string type = std::string(gzqr_config::kProjectName) + "-CHUNK-ENC";
-  const std::string projVer = gzqr_config::kProjectVersion;
-  const std::string fakeCipherSha(64,'0');
-  const std::vector<uint8_t> fakeSalt(16, 0x11);
-  const std::vector<uint8_t> fakeNonce(12,0x22);
-  const std::string saltB64 = b64(fakeSalt);
-  const std::string nonceB64= b64(fakeNonce);
-  const int worstChunk = 999999;
-  const int worstTotal = 999999;
-  const int worstChunkSize = 999999;
-
-  int lo = 32, hi = 1<<16;
-  auto fits = [&](int dataBytes)->bool{
-    std::vector<uint8_t> data((size_t)dataBytes, 0x41);
-    std::map<std::string,mini_json::value> meta;
-    meta["type"]       = type;
-    meta["version"]    = projVer;
-    meta["chunk"]      = (double)worstChunk;
-    meta["total"]      = (double)worstTotal;
-    meta["hash"]       = std::string(64,'0');
-    meta["cipherHash"] = fakeCipherSha;
-    meta["saltB64"]    = saltB64;
-    meta["nonceB64"]   = nonceB64;
-    meta["name"]       = nameBase;
-    meta["ext"]        = metaExt;
-    meta["chunkSize"]  = (double)worstChunkSize;
-    meta["dataB64"]    = b64(data);
-    std::string payload = mini_json::value(meta).dump();
-    return payload_fits(payload, version, ecl);
+  namespace fs=std::filesystem;
+  chunk_ctx ctx; ctx.outdir=outdir; ctx.png=o.png;
+  ctx.ecl=qr_ecl(); ctx.version=qr_version(); ctx.margin=qr_margin(); ctx.scale=qr_scale();
+  const int chunk_size=std::max(64,o.binChunkSize); ctx.chunkSize=chunk_size;
+  std::string nameBase,metaExt; describe_input(input,nameBase,metaExt);
+
+  const auto bk=cdc::derive_keys(key,salt); const std::string check=cdc::key_check(key,salt);
+  if(!idx.check.empty() && idx.check!=check)
+    throw std::runtime_error("Index was written with a different password (remove gzqr-index.txt to start over)");
+  const bool reusable=idx.chunkSize==chunk_size;   // codes of another size can't be mixed in
+  std::fprintf(stdout,"STEP #3 chunk & encode QR ... (incremental, chunkSize=%d jobs=%u, %zu blocks indexed)\n",chunk_size,o.jobs,idx.blocks.size());
+
+  std::vector<cdc::recipe_entry> recipe; std::set<std::string> seen;
+  std::map<std::string,cdc::block_index::entry> fresh; std::mutex freshMu;
+  int reused=0, rendered=0; std::atomic<int> written{0};
+  auto on_disk=[&](const std::string& h,const cdc::block_index::entry& e){
+    for(int p=0;p<e.parts;p++) if(!fs::exists(fs::path(outdir)/cdc::block_png(h,p))) return false;
+    return true;
   };
-  while(lo < hi){
-    int mid = (lo + hi + 1)/2;
-    if(fits(mid)) lo = mid; else hi = mid - 1;
+  // New blocks are sealed and rendered on the pool; the cutter stays on this thread.
+  cdc::cdc_sink cut([&](std::vector<uint8_t> b){
+    cdc::block_id id=cdc::content_id(bk,b.data(),b.size());
+    recipe.push_back({id,(uint32_t)b.size()});
+    std::string h=hex(id.data(),id.size());
+    if(!seen.insert(h).second) return;
+    auto it=idx.blocks.find(h);
+    if(reusable && it!=idx.blocks.end() && it->second.size==b.size() && on_disk(h,it->second)){
+      std::lock_guard<std::mutex> lk(freshMu); fresh[h]=it->second; reused++; return;
+    }
+    rendered++;
+    pool.submit([&,id,h,b=std::move(b)]{
+      std::vector<uint8_t> sealed;
+      { stat_scope sc(stEncrypt,b.size(),true); sealed=cdc::seal_block(bk,id,b,o.comp); }
+      std::vector<std::vector<uint8_t>> codes;
+      { stat_scope sc(stChunkBuild,sealed.size()); codes=part_codes(chunkfmt::kBlock,cdc::aad_of(id),sealed,(size_t)chunk_size); }
+      for(size_t p=0;p<codes.size();p++) write_code(ctx,cdc::block_png(h,(int)p),codes[p].data(),codes[p].size());
+      { std::lock_guard<std::mutex> lk(freshMu); fresh[h]={(int)codes.size(),(uint32_t)b.size()}; }
+      int n=++written;
+      if(gzqr_config::kPrintProgressCounters){ std::lock_guard<std::mutex> lk(outMu); std::fprintf(stdout,"   block %d written\n",n); }
+    });
+  });
+  int recipeParts=0;
+  try{
+    stat_sink cutStat(stChunker,cut);
+    { stat_scope sc(stInput); produce_input(input,cutStat); }
+    cutStat.finish();
+
+    // Recipe: sealed under the block key with a fresh nonce, since it changes every run.
+    auto plain=cdc::recipe_bytes(recipe);
+    std::vector<uint8_t> nonce(12); RAND_bytes(nonce.data(),12);
+    vector_sink sealed;
+    { stat_scope sc(stEncrypt,plain.size()); gcm_encrypt_sink e(bk.enc,nonce,cdc::recipe_aad(),sealed); e.write(plain.data(),plain.size()); e.finish(); }
+    auto codes=part_codes(chunkfmt::kRecipe,{},sealed.data,(size_t)chunk_size);
+    recipeParts=(int)codes.size();
+    for(int p=0;p<recipeParts;p++) pool.submit([&ctx,p,c=std::move(codes[p])]{ write_code(ctx,recipe_png(p),c.data(),c.size()); });
+
+    chunkfmt::manifest m;
+    m.cipherSha.resize(32); SHA256(sealed.data.data(),sealed.data.size(),m.cipherSha.data());
+    m.salt=salt; m.nonce=nonce; m.chunkSize=(uint32_t)chunk_size; m.cipherSize=sealed.data.size();
+    m.name=nameBase; m.ext=metaExt; m.layout=cdc::kLayoutCdc;
+    if((int)manifest_code(m,recipeParts).size()>qr_byte_capacity(ctx.version,ctx.ecl)) throw std::runtime_error("Name too long for manifest code");
+    pool.wait();
+    for(int c=0;c<chunkfmt::kManifestCopies;c++){ auto man=manifest_code(m,recipeParts,c); write_code(ctx,chunkfmt::manifest_png(c),man.data(),man.size()); }
+  }catch(...){ try{ pool.wait(); }catch(...){} throw; }   // tasks refer to this frame
+
+  // Codes of blocks (and recipe parts) the new recipe doesn't use.
+  int removed=0;
+  for(auto& [h,e]:idx.blocks){
+    auto it=fresh.find(h); int keep=it==fresh.end()?0:it->second.parts;
+    if(!keep) removed++;
+    for(int p=keep;p<e.parts;p++) fs::remove(fs::path(outdir)/cdc::block_png(h,p));
+  }
+  for(int p=recipeParts;p<idx.recipeParts;p++) fs::remove(fs::path(outdir)/recipe_png(p));
+  idx.salt=salt; idx.check=check; idx.chunkSize=chunk_size; idx.recipeParts=recipeParts; idx.blocks=std::move(fresh);
+  idx.save(outdir);
+  std::printf("\n✅ Done. Blocks: %zu in file, %zu unique (%d reused, %d rendered, %d removed), %d recipe codes → %s\n",
+              recipe.size(),seen.size(),reused,rendered,removed,recipeParts,outdir.c_str());
+}
+
+// ---------------- Batch ----------------
+// Inputs of a batch: every entry of a directory (each file or subdirectory
+// is its own archive), or a list file with one path per line ("-" = stdin,
+// blank lines and # comments skipped).
+static std::vector<std::string> batch_inputs(const std::string& src){
+  std::vector<std::string> v;
+  if(is_dir(src)){
+    for(auto& e: std::filesystem::directory_iterator(src)) v.push_back(e.path().string());
+    std::sort(v.begin(),v.end());
+    return v;
   }
-  return std::max(16, lo - 16); // safety headroom
+  FILE* f=src=="-"?stdin:fopen(src.c_str(),"rb"); if(!f) throw std::runtime_error("open batch list");
+  std::string line; int c;
+  auto flush=[&]{
+    while(!line.empty() && (line.back()=='\r' || line.back()==' ' || line.back()=='\t')) line.pop_back();
+    if(!line.empty() && line[0]!='#') v.push_back(line);
+    line.clear();
+  };
+  while((c=fgetc(f))!=EOF){ if(c=='\n') flush(); else line.push_back((char)c); }
+  flush();
+  if(f!=stdin) fclose(f);
+  return v;
+}
+// Output subdirectory per input: its file name, made unique within the run.
+static std::string batch_subdir(const std::string& input,std::map<std::string,int>& used){
+  auto p=std::filesystem::path(input);
+  std::string base=p.filename().string(); if(base.empty()) base=p.parent_path().filename().string();
+  if(base.empty() || base=="." || base=="..") base="input";
+  int n=++used[base];
+  return n==1?base:base+"-"+std::to_string(n);
 }
 
 // ---------------- Main ----------------
 int main(int argc,char** argv){
-  if(argc<2){ std::fprintf(stderr,"Usage: MakeEncode <input_file_or_dir> [output_dir]\n"); return 2; }
+  std::vector<std::string> args; int jobs=gzqr_config::kDefaultJobs; bool batch=false, incremental=false;
+  run_opts o; o.format=gzqr_config::kDefaultChunkFormat;
+  bool badOpt=false, showStats=false; std::string statsJson;
+  parse_compress(gzqr_config::kDefaultCompression,o.comp);
+  parse_parity(gzqr_config::kDefaultParity,gzqr_config::kDefaultParityGroup,o.par);
+  parse_png_mode(gzqr_config::kDefaultPngMode,o.png.mode); o.png.zlevel=gzqr_config::kDefaultPngZLevel;
+  parse_png_strategy(gzqr_config::kDefaultPngStrategy,o.png.zstrategy); parse_png_filter(gzqr_config::kDefaultPngFilter,o.png.filter);
+  for(int a=1;a<argc;a++){
+    std::string s=argv[a];
+    auto opt=[&](const char* name,std::string& val)->bool{
+      std::string n=name; if(s==n && a+1<argc){ val=argv[++a]; return true; }
+      if(s.rfind(n+"=",0)==0){ val=s.substr(n.size()+1); return true; } return false; };
+    std::string v;
+    if(s=="-j" && a+1<argc) jobs=std::atoi(argv[++a]);
+    else if(opt("--jobs",v)) jobs=std::atoi(v.c_str());
+    else if(opt("--format",v)) o.format=v;
+    else if(opt("--compress",v)) badOpt|=!parse_compress(v,o.comp);
+    else if(opt("--png",v)) badOpt|=!parse_png_mode(v,o.png.mode);
+    else if(opt("--png-level",v)) o.png.zlevel=std::atoi(v.c_str());
+    else if(opt("--png-strategy",v)) badOpt|=!parse_png_strategy(v,o.png.zstrategy);
+    else if(opt("--png-filter",v)) badOpt|=!parse_png_filter(v,o.png.filter);
+    else if(opt("--sheet",v)) o.sheet=v;
+    else if(opt("--parity",v)) badOpt|=!parse_parity(v,gzqr_config::kDefaultParityGroup,o.par);
+    else if(s=="--rgb") o.rgb=true;
+    else if(s=="--indexed") o.indexed=true;
+    else if(opt("--frames",v)) o.frames=v;
+    else if(s=="--batch") batch=true;
+    else if(s=="--incremental") incremental=true;
+    else if(s=="--stats") showStats=true;
+    else if(opt("--stats-json",v)) statsJson=v;
+    else args.push_back(s);
+  }
+  if(incremental && (batch || o.format!="bin" || !o.sheet.empty() || o.par.on() || o.rgb || !o.frames.empty() || o.indexed)){
+    std::fprintf(stderr,"--incremental works with --format bin only, without --batch, --sheet, --rgb, --frames, --indexed or --parity\n"); return 2; }
+  if(batch && !o.frames.empty()){ std::fprintf(stderr,"--frames writes one archive; it can't be combined with --batch\n"); return 2; }
+  if(args.empty() || badOpt || (o.format!="bin" && o.format!="json")){
+    std::fprintf(stderr,"Usage: MakeEncode <input_file_or_dir> [output_dir] [--jobs N] [--format bin|json]\n"
+                        "       MakeEncode --batch <dir|list.txt|-> [output_dir] [options]\n"
+                        "       MakeEncode --incremental <input_file_or_dir> [output_dir] [options]\n"
+                        "                  [--compress auto|none|deflate[:0-9]|xz[:0-9]%s]\n"
+                        "                  [--png gray1|rgba] [--png-level 0-9] [--png-strategy auto|default|filtered|huffman|rle|fixed]\n"
+                        "                  [--png-filter default|none|sub|up|avg|paeth|all] [--sheet NxM|a4 (N,M 1-255)]\n"
+                        "                  [--rgb] [--frames out.y4m|-] [--indexed] [--parity off|N+K|P%%] [--stats] [--stats-json FILE]\n",
+                        codec_available(kCodecZstd)?"|zstd[:1-22]":""); return 2; }
+  if(showStats || !statsJson.empty()) stats().enable();
   try{
     std::srand((unsigned)time(nullptr));
-    std::string input=argv[1];
-    std::string outdir=argc>=3?argv[2]:"qrcodes";
-    std::filesystem::create_directories(outdir);
+    std::string input=args[0];
+    std::string outdir=args.size()>=2?args[1]:"qrcodes";
+    if(o.frames=="-"){
+      // The video goes to stdout; console output moves to stderr.
+      std::fflush(stdout); int fd=dup(1);
+      if(fd<0 || dup2(2,1)<0 || !(o.framesOut=fdopen(fd,"wb"))) throw std::runtime_error("stdout");
+    } else if(!o.frames.empty()){
+      if(!(o.framesOut=fopen(o.frames.c_str(),"wb"))) throw std::runtime_error("open "+o.frames);
+    } else std::filesystem::create_directories(outdir);
+    std::vector<std::string> inputs;
+    if(batch){ inputs=batch_inputs(input); if(inputs.empty()) throw std::runtime_error("Batch has no inputs"); }
 
     // 1) Password (from config; override with GZQR_PASS if set)
     std::string pass = std::getenv("GZQR_PASS") ? std::getenv("GZQR_PASS") : std::string(gzqr_config::kDefaultPassword);
     if(pass.size()<8) throw std::runtime_error("Password >=8 required");
 
-    // 2) Prepare data
-    std::fprintf(stdout,"STEP #2 prepare data ... ");
-    std::string nameBase,metaExt; std::string dataPath=materialize_data(input,nameBase,metaExt);
-    std::fprintf(stdout,"[1]\n");
-
-    // 3) Encrypt
-    std::fprintf(stdout,"STEP #3 encrypt ... ");
-    std::vector<uint8_t> salt(16),nonce(12); RAND_bytes(salt.data(),16); RAND_bytes(nonce.data(),12);
+    // 2) Key: one scrypt per run. Incremental runs keep the index's salt so
+    // unchanged blocks keep their key, id and codes.
+    cdc::block_index idx;
+    bool haveIdx=incremental && idx.load(outdir);
+    std::fprintf(stdout,"STEP #2 derive key ... ");
+    std::vector<uint8_t> salt(16); RAND_bytes(salt.data(),16);
+    if(haveIdx && idx.salt.size()==16) salt=idx.salt;
     KDFParams kdf{(1u<<15),8u,(uint32_t)std::max(1u,std::thread::hardware_concurrency())};
-    auto key=scrypt_kdf(pass,salt,kdf);
-    std::string encPath=tmpfile("payload-")+".enc"; aes_gcm_encrypt_file(dataPath,encPath,key,nonce,{});
-    std::string cipherSha=sha256_hex_file(encPath); std::fprintf(stdout,"[1]\n");
+    std::vector<uint8_t> key;
+    { stat_scope sc(stKdf); key=scrypt_kdf(pass,salt,kdf); }
+    std::fprintf(stdout,"[1]\n");
 
-    // 4) Chunk & Encode
-    const int ECL=qr_ecl(),QVER=qr_version(),MARGIN=qr_margin(),SCALE=qr_scale();
-    FILE* f=fopen(encPath.c_str(),"rb"); if(!f) throw std::runtime_error("open enc");
-    fseek(f,0,SEEK_END); long sz=ftell(f); fseek(f,0,SEEK_SET);
+    o.jobs=resolve_jobs(jobs);
+    o.binChunkSize=max_bin_bytes_per_chunk(qr_version(),qr_ecl());
+    std::mutex outMu; std::atomic<int> done{0}, chunks{0};   // outlive the pool: jobs use them
+    worker_pool pool(o.jobs,(size_t)o.jobs*gzqr_config::kQueuedChunksPerJob);
 
-    int chunk_size = max_data_bytes_per_chunk(QVER,ECL,nameBase,metaExt);
-    if(chunk_size < 64) chunk_size = 64;
-    int total=(int)((sz+chunk_size-1)/chunk_size);
-
-    std::fprintf(stdout,"STEP #4 chunk & encode QR ... (chunkSize=%d total=%d)\n",chunk_size,total);
-    std::vector<uint8_t> buf(chunk_size);
-
-    for(int i=0;i<total;i++){
-      size_t rd=fread(buf.data(),1,chunk_size,f);
-      std::vector<uint8_t> view(buf.begin(),buf.begin()+rd);
-
-      std::map<std::string,value> meta;
-      meta["type"]=std::string(gzqr_config::kProjectName)+"-CHUNK-ENC";
-      meta["version"]=gzqr_config::kProjectVersion;
-      meta["chunk"]=(double)i;
-      meta["total"]=(double)total;
-      meta["hash"]=sha256_hex(view);
-      meta["cipherHash"]=cipherSha;
-      meta["saltB64"]=b64(salt);
-      meta["nonceB64"]=b64(nonce);
-      meta["name"]=nameBase;
-      meta["ext"]=metaExt;
-      meta["chunkSize"]=(double)chunk_size;
-      meta["dataB64"]=b64(view);
-
-      std::string payload=value(meta).dump();
-      if(!payload_fits(payload,QVER,ECL)){ fclose(f); throw std::runtime_error("Internal error: calibrated payload did not fit"); }
-
-      char fn[64]; std::snprintf(fn,sizeof(fn),"qr-%06d.png",i);
-      QRcode* q=QRcode_encodeString(payload.c_str(),QVER,(QRecLevel)ECL,QR_MODE_8,1);
-      write_qr_png((std::filesystem::path(outdir)/fn).string(),q,MARGIN,SCALE);
-      QRcode_free(q);
-
-      if(gzqr_config::kPrintProgressCounters)
-        std::fprintf(stdout,"   chunk %d/%d written\n",i+1,total);
+    if(incremental) encode_incremental(input,outdir,o,key,salt,idx,pool,outMu);
+    else if(!batch){
+      archive_keys k{key,salt,{},std::vector<uint8_t>(12)}; RAND_bytes(k.nonce.data(),12);
+      auto job=encode_archive(input,outdir,o,k,pool,outMu);
+      job->release();
+      pool.wait();
+      if(job->sheets) std::printf("\n✅ Done. Chunks: %d on %d sheets → %s\n",job->total,job->sheets->sheets(),outdir.c_str());
+      else if(job->frames) std::printf("\n✅ Done. Chunks: %d as %d frames → %s\n",job->total,job->frames->frames(),o.frames=="-"?"stdout":o.frames.c_str());
+      else if(job->planes) std::printf("\n✅ Done. Chunks: %d in %d RGB images → %s\n",job->total,job->planes->images(),outdir.c_str());
+      else std::printf("\n✅ Done. Chunks: %d → %s\n",job->total,outdir.c_str());
+      if(!job->index.empty()) std::printf("   Index: %zu codes\n",job->index.size());
+      if(job->parityCodes) std::printf("   Parity: %d codes (%d per %d chunks)%s\n",job->parityCodes,o.par.k,o.par.n,
+                                       job->paritySheets?(" on "+std::to_string(job->paritySheets->sheets())+" sheets").c_str():
+                                       job->parityPlanes?(" in "+std::to_string(job->parityPlanes->images())+" RGB images").c_str():"");
+    } else {
+      // 3) Every input streams through the shared pool; archives overlap, so
+      // small files keep all workers busy.
+      o.verbose=false;
+      std::fprintf(stdout,"STEP #3 encrypt & encode QR ... (batch of %zu, format=%s jobs=%u)\n",inputs.size(),o.format.c_str(),o.jobs);
+      std::map<std::string,int> used; const int n=(int)inputs.size();
+      for(const auto& in:inputs){
+        std::string sub=batch_subdir(in,used);
+        archive_keys k{{},salt,std::vector<uint8_t>(16),std::vector<uint8_t>(12)};
+        RAND_bytes(k.keySalt.data(),16); RAND_bytes(k.nonce.data(),12);
+        k.key=hkdf_sha256(key,k.keySalt,std::string(gzqr_config::kProjectName)+" archive key");
+        auto job=encode_archive(in,(std::filesystem::path(outdir)/sub).string(),o,k,pool,outMu);
+        job->onDone=[&done,&chunks,&outMu,n,sub](archive_job& j){
+          int d=++done; chunks+=j.total;
+          std::lock_guard<std::mutex> lk(outMu);
+          std::fprintf(stdout,"   [%d/%d] %s: %d chunks\n",d,n,sub.c_str(),j.total);
+        };
+        job->release();
+      }
+      pool.wait();
+      std::printf("\n✅ Done. %d archives, %d chunks → %s\n",n,chunks.load(),outdir.c_str());
     }
-    fclose(f);
-    std::printf("\n✅ Done. Chunks: %d → %s\n",total,outdir.c_str());
+    if(showStats) stats().print(stdout);
+    if(!statsJson.empty()) stats().write_json(statsJson,"encode");
     return 0;
   }catch(const std::exception& e){
     std::fprintf(stderr,"Error: %s\n",e.what()); return 1;
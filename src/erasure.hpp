@@ -0,0 +1,165 @@
+#pragma once
+/*
+ * GitZipQR.cpp – erasure-coded parity chunks
+ *
+ * Data chunks are grouped N at a time (the last group may be shorter) and
+ * each group gets K parity chunks from a systematic Reed–Solomon code over
+ * GF(2^8). Any N of the N+K codes rebuild the group, so up to K unreadable or
+ * damaged codes per group cost nothing. Damaged codes are already dropped by
+ * the per-chunk digest, so every loss is an erasure at a known position.
+ *
+ * Row r of the generator is the identity for data (r < N) and the Cauchy row
+ * 1/(r ^ c) for parity (r = N+j). Every square submatrix of a Cauchy matrix
+ * is invertible, so any N rows work. Parity is computed over data padded
+ * with zeros to the chunk size.
+ *
+ * The inner loop is dst ^= c·src, done with pshufb nibble tables (AVX2 or
+ * SSSE3, picked at run time) and a table-lookup scalar fallback.
+ */
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define GZQR_GF_X86 1
+#endif
+
+namespace gzqr {
+
+// "--parity" value: off | N+K (K parity per N data codes) | P% (over the default group size).
+struct parity_opts { int n=0, k=0; bool on()const{ return k>0; } };
+inline bool parse_parity(const std::string& s,int defaultGroup,parity_opts& o){
+  if(s.empty() || s=="off" || s=="none"){ o=parity_opts{}; return true; }
+  int a=0,b=0; char x=0; int r=std::sscanf(s.c_str(),"%d%c%d",&a,&x,&b);
+  if(r==3 && x=='+'){}
+  else if(r==2 && x=='%' && a>0 && a<=100){ b=(defaultGroup*a+99)/100; a=defaultGroup; }
+  else return false;
+  if(a<1 || b<1 || a+b>256) return false;
+  o=parity_opts{a,b}; return true;
+}
+
+namespace gf {
+
+struct tables {
+  uint8_t exp[512], log[256];
+  tables(){
+    int x=1;
+    for(int i=0;i<255;i++){ exp[i]=(uint8_t)x; log[x]=(uint8_t)i; x<<=1; if(x&0x100) x^=0x11d; }
+    for(int i=255;i<512;i++) exp[i]=exp[i-255];
+    log[0]=0;
+  }
+};
+inline const tables& tab(){ static const tables t; return t; }
+inline uint8_t mul(uint8_t a,uint8_t b){ if(!a||!b) return 0; const auto& t=tab(); return t.exp[t.log[a]+t.log[b]]; }
+inline uint8_t inv(uint8_t a){ if(!a) throw std::runtime_error("gf: inverse of 0"); const auto& t=tab(); return t.exp[255-t.log[a]]; }
+
+// ---------------- dst ^= c·src ----------------
+inline void mul_add_scalar(uint8_t* d,const uint8_t* s,size_t n,uint8_t c){
+  if(!c) return;
+  uint8_t row[256]; for(int i=0;i<256;i++) row[i]=mul(c,(uint8_t)i);
+  for(size_t i=0;i<n;i++) d[i]^=row[s[i]];
+}
+
+#ifdef GZQR_GF_X86
+// c·x = c·(x & 15) ^ c·(x & 0xF0): two 16-entry tables, one pshufb each.
+inline void nibble_tables(uint8_t c,uint8_t* lo,uint8_t* hi){
+  for(int i=0;i<16;i++){ lo[i]=mul(c,(uint8_t)i); hi[i]=mul(c,(uint8_t)(i<<4)); }
+}
+__attribute__((target("ssse3"))) inline void mul_add_ssse3(uint8_t* d,const uint8_t* s,size_t n,uint8_t c){
+  if(!c) return;
+  alignas(16) uint8_t lo[16], hi[16]; nibble_tables(c,lo,hi);
+  const __m128i tl=_mm_load_si128((const __m128i*)lo), th=_mm_load_si128((const __m128i*)hi), m=_mm_set1_epi8(0x0f);
+  size_t i=0;
+  for(;i+16<=n;i+=16){
+    __m128i x=_mm_loadu_si128((const __m128i*)(s+i));
+    __m128i p=_mm_xor_si128(_mm_shuffle_epi8(tl,_mm_and_si128(x,m)),_mm_shuffle_epi8(th,_mm_and_si128(_mm_srli_epi64(x,4),m)));
+    _mm_storeu_si128((__m128i*)(d+i),_mm_xor_si128(_mm_loadu_si128((const __m128i*)(d+i)),p));
+  }
+  for(;i<n;i++) d[i]^=lo[s[i]&15]^hi[s[i]>>4];
+}
+__attribute__((target("avx2"))) inline void mul_add_avx2(uint8_t* d,const uint8_t* s,size_t n,uint8_t c){
+  if(!c) return;
+  alignas(16) uint8_t lo[16], hi[16]; nibble_tables(c,lo,hi);
+  const __m256i tl=_mm256_broadcastsi128_si256(_mm_load_si128((const __m128i*)lo));
+  const __m256i th=_mm256_broadcastsi128_si256(_mm_load_si128((const __m128i*)hi)), m=_mm256_set1_epi8(0x0f);
+  size_t i=0;
+  for(;i+32<=n;i+=32){
+    __m256i x=_mm256_loadu_si256((const __m256i*)(s+i));
+    __m256i p=_mm256_xor_si256(_mm256_shuffle_epi8(tl,_mm256_and_si256(x,m)),_mm256_shuffle_epi8(th,_mm256_and_si256(_mm256_srli_epi64(x,4),m)));
+    _mm256_storeu_si256((__m256i*)(d+i),_mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(d+i)),p));
+  }
+  for(;i<n;i++) d[i]^=lo[s[i]&15]^hi[s[i]>>4];
+}
+#endif
+
+using mul_add_fn=void(*)(uint8_t*,const uint8_t*,size_t,uint8_t);
+struct kernel { const char* name; mul_add_fn fn; };
+// Every kernel this CPU can run, fastest first (the bench compares them).
+inline std::vector<kernel> kernels(){
+  std::vector<kernel> k;
+#ifdef GZQR_GF_X86
+  if(__builtin_cpu_supports("avx2")) k.push_back({"avx2",mul_add_avx2});
+  if(__builtin_cpu_supports("ssse3")) k.push_back({"ssse3",mul_add_ssse3});
+#endif
+  k.push_back({"scalar",mul_add_scalar});
+  return k;
+}
+inline const kernel& active(){ static const kernel k=kernels().front(); return k; }
+inline void mul_add(uint8_t* d,const uint8_t* s,size_t n,uint8_t c){ active().fn(d,s,n,c); }
+
+} // namespace gf
+
+// Generator row r (r < N data, r = N+j parity), column c.
+inline uint8_t rs_coef(int N,int r,int c){ return r<N ? (uint8_t)(r==c) : gf::inv((uint8_t)(r^c)); }
+
+// Accumulates the K parity chunks of the current group as data arrives.
+class rs_encoder {
+public:
+  rs_encoder(parity_opts p,size_t len):p_(p),len_(len),par_(p.k,std::vector<uint8_t>(len)){}
+  void add(int col,const uint8_t* d,size_t n){
+    if(n>len_) throw std::runtime_error("parity: chunk larger than chunk size");
+    for(int j=0;j<p_.k;j++) gf::mul_add(par_[j].data(),d,n,rs_coef(p_.n,p_.n+j,col));
+    cols_++;
+  }
+  bool empty()const{ return cols_==0; }
+  // The finished group's parity; the encoder starts over.
+  std::vector<std::vector<uint8_t>> take(){
+    std::vector<std::vector<uint8_t>> out(p_.k,std::vector<uint8_t>(len_)); out.swap(par_); cols_=0; return out;
+  }
+private: parity_opts p_; size_t len_; std::vector<std::vector<uint8_t>> par_; int cols_=0;
+};
+
+// One surviving code of a group: generator row and its bytes (data may be
+// shorter than the chunk size; the rest is zero).
+struct rs_piece { int row; const std::vector<uint8_t>* data; };
+
+/*
+ * Rebuilds the data columns `missing` of a group with n data chunks from
+ * exactly n pieces. Each result is `len` bytes; the caller trims the last
+ * chunk of the archive.
+ */
+inline std::vector<std::vector<uint8_t>> rs_rebuild(int N,int n,size_t len,const std::vector<rs_piece>& pieces,const std::vector<int>& missing){
+  if((int)pieces.size()!=n) throw std::runtime_error("parity: need exactly n pieces");
+  // Gauss–Jordan on [A | I]; A row i is the generator row of piece i.
+  std::vector<std::vector<uint8_t>> a(n,std::vector<uint8_t>(2*n,0));
+  for(int i=0;i<n;i++){ for(int c=0;c<n;c++) a[i][c]=rs_coef(N,pieces[i].row,c); a[i][n+i]=1; }
+  for(int c=0;c<n;c++){
+    int p=c; while(p<n && !a[p][c]) p++;
+    if(p==n) throw std::runtime_error("parity: singular matrix");
+    std::swap(a[p],a[c]);
+    uint8_t f=gf::inv(a[c][c]); for(auto& v:a[c]) v=gf::mul(v,f);
+    for(int r=0;r<n;r++) if(r!=c && a[r][c]){ uint8_t g=a[r][c]; for(int k=0;k<2*n;k++) a[r][k]^=gf::mul(g,a[c][k]); }
+  }
+  std::vector<std::vector<uint8_t>> out;
+  for(int m:missing){
+    std::vector<uint8_t> d(len,0);
+    for(int i=0;i<n;i++){ const auto& src=*pieces[i].data; gf::mul_add(d.data(),src.data(),std::min(src.size(),len),a[m][n+i]); }
+    out.push_back(std::move(d));
+  }
+  return out;
+}
+
+} // namespace gzqr
@@ -0,0 +1,212 @@
+#pragma once
+/*
+ * GitZipQR.cpp – frame streams (--frames)
+ *
+ * For moving archives through a screen and a camera: the encoder writes its
+ * codes as frames of one Y4M video (8-bit grey, "Cmono") instead of PNGs,
+ * and the decoder reads a Y4M file or raw grey frames (--raw WxH) from a
+ * file or stdin. Y4M input may use any 8-bit colour space; only the luma
+ * plane is read and chroma is skipped.
+ *
+ * A recording shows each code for many frames. The decoder hashes every
+ * frame first (a difference hash: 256 bits, each block mean against its
+ * right neighbour's) and
+ * skips frames that match the previous one, so ZXing runs about once per
+ * code shown. Repeats that still get through are dropped once their header
+ * is read (stream_assembler::wants), and reading stops as soon as every
+ * chunk is in. The encoder writes codes in stream order with the manifest up
+ * front and repeated (see y4m_writer), so that happens on the first pass.
+ */
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace gzqr {
+
+// ---------------- Writer ----------------
+/*
+ * One Y4M stream of equally sized code frames. Codes are written in the
+ * order the archive emits them (data, and each group's parity after it),
+ * whatever order the workers finish in: expect() is called in that order on
+ * the producing thread, place() from any worker, and frames that arrive
+ * early wait in a small reorder buffer (module matrices, not pixels).
+ *
+ * The manifest is only known at the end. Frames are fixed-size, so on a
+ * seekable file blank frames are reserved for it at the start and after
+ * every `metaEvery` code frames, and finish() seeks back to fill them: a
+ * decoder gets the metadata first, and a looped recording that starts
+ * midway gets it within `metaEvery` frames. A pipe can't seek; there the
+ * manifest frames are appended at the end.
+ */
+class y4m_writer {
+public:
+  // Takes ownership of f (closed by finish). Codes are qsize modules wide.
+  // metaLead manifest frames go first, one more after every metaEvery code
+  // frames; 0 = no manifest frames (v1 JSON codes carry their own metadata).
+  y4m_writer(FILE* f,int qsize,int margin,int scale,int fps,int metaLead,int metaEvery)
+    :f_(f),qsize_(qsize),margin_(margin),scale_(scale),size_((qsize+2*margin)*scale),every_(metaEvery){
+    if(!f_) throw std::runtime_error("open frames");
+    std::fprintf(f_,"YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 Cmono\n",size_,size_,fps);
+    seekable_=every_>0 && std::ftell(f_)>=0 && std::fseek(f_,0,SEEK_CUR)==0;
+    if(seekable_) for(int k=0;k<metaLead;k++) reserve();
+  }
+  ~y4m_writer(){ if(f_) fclose(f_); }
+  y4m_writer(const y4m_writer&)=delete; y4m_writer& operator=(const y4m_writer&)=delete;
+
+  // Producer thread, in stream order: code (kind, index) comes next.
+  void expect(uint8_t kind,int index){ std::lock_guard<std::mutex> lk(m_); order_[{kind,index}]=expected_++; }
+  // `modules` is libqrencode's qsize×qsize matrix (bit 0 = dark), copied.
+  void place(uint8_t kind,int index,const unsigned char* modules,int qsize){
+    if(qsize!=qsize_) throw std::runtime_error("frame size mismatch");
+    std::vector<uint8_t> m(modules,modules+(size_t)qsize*qsize);
+    std::lock_guard<std::mutex> lk(m_);
+    auto it=order_.find({kind,index});
+    if(it==order_.end()) throw std::runtime_error("frame not expected");
+    early_.emplace(it->second,std::move(m)); order_.erase(it);
+    for(auto e=early_.find(next_); e!=early_.end(); e=early_.find(next_)){
+      write(e->second);
+      early_.erase(e); next_++;
+      if(seekable_ && next_%every_==0) reserve();
+    }
+  }
+  // A manifest copy, written by finish().
+  void place_meta(const unsigned char* modules,int qsize){
+    if(qsize!=qsize_) throw std::runtime_error("frame size mismatch");
+    std::lock_guard<std::mutex> lk(m_); meta_.emplace_back(modules,modules+(size_t)qsize*qsize);
+  }
+  void finish(){
+    std::lock_guard<std::mutex> lk(m_);
+    if(!f_) return;
+    if(!early_.empty() || !order_.empty()) throw std::runtime_error("frames missing from the stream");
+    if(!seekable_) for(auto& m:meta_) write(m);
+    else if(!meta_.empty()){
+      for(size_t k=0;k<slots_.size();k++){
+        if(std::fseek(f_,slots_[k],SEEK_SET)!=0) throw std::runtime_error("write frames");
+        write(meta_[k%meta_.size()],false);
+      }
+    }
+    int r=std::fclose(f_); f_=nullptr;
+    if(r) throw std::runtime_error("write frames");
+  }
+  int frames()const{ return frames_; }
+
+private:
+  // One frame at the current position (m_ held); empty = blank.
+  void write(const std::vector<uint8_t>& modules,bool count=true){
+    std::vector<uint8_t> px((size_t)size_*size_,0xFF);
+    for(int my=0;my<qsize_ && !modules.empty();my++){
+      uint8_t* row=&px[(size_t)(margin_+my)*scale_*size_];
+      for(int mx=0;mx<qsize_;mx++) if(modules[(size_t)my*qsize_+mx]&1) std::memset(row+(size_t)(margin_+mx)*scale_,0,(size_t)scale_);
+      for(int k=1;k<scale_;k++) std::memcpy(row+(size_t)k*size_,row,(size_t)size_);
+    }
+    if(std::fputs("FRAME\n",f_)<0 || std::fwrite(px.data(),1,px.size(),f_)!=px.size()) throw std::runtime_error("write frames");
+    if(count) frames_++;
+  }
+  // A blank frame to be overwritten with a manifest copy by finish().
+  void reserve(){ slots_.push_back(std::ftell(f_)); write({}); }
+
+  FILE* f_; int qsize_, margin_, scale_, size_, every_; bool seekable_=false;
+  std::mutex m_; int frames_=0, expected_=0, next_=0;
+  std::map<std::pair<uint8_t,int>,int> order_; std::map<int,std::vector<uint8_t>> early_;
+  std::vector<std::vector<uint8_t>> meta_; std::vector<long> slots_;
+};
+
+// ---------------- Reader ----------------
+class frame_reader {
+public:
+  // Y4M, or raw w×h grey frames when rawW > 0 and the stream has no Y4M header.
+  frame_reader(FILE* f,int rawW,int rawH):f_(f){
+    char magic[10]; size_t n=std::fread(magic,1,sizeof(magic),f_);
+    if(n==sizeof(magic) && std::memcmp(magic,"YUV4MPEG2 ",10)==0){ y4m_=true; header(); return; }
+    if(rawW<=0 || rawH<=0) throw std::runtime_error("Not a Y4M stream (raw frames need --raw WxH)");
+    w_=rawW; h_=rawH; carry_.assign(magic,magic+n);
+  }
+  int width()const{ return w_; }
+  int height()const{ return h_; }
+
+  // Luma of the next frame; false at the end (a truncated last frame counts as the end).
+  bool next(std::vector<uint8_t>& y){
+    if(y4m_){
+      std::string line;
+      if(!read_line(line)) return false;
+      if(line.rfind("FRAME",0)!=0) throw std::runtime_error("Bad Y4M frame header");
+    }
+    const size_t n=(size_t)w_*h_; y.resize(n);
+    size_t have=std::min(carry_.size(),n);
+    std::memcpy(y.data(),carry_.data(),have); carry_.erase(carry_.begin(),carry_.begin()+have);
+    if(std::fread(y.data()+have,1,n-have,f_)!=n-have) return false;
+    for(size_t left=chroma_;left>0;){
+      skip_.resize(std::min(left,(size_t)1<<20));
+      size_t k=std::fread(skip_.data(),1,skip_.size(),f_); if(k==0) return false;
+      left-=k;
+    }
+    return true;
+  }
+
+private:
+  bool read_line(std::string& s){
+    s.clear(); int c;
+    while((c=std::fgetc(f_))!=EOF && c!='\n'){ s+=(char)c; if(s.size()>4096) throw std::runtime_error("Bad Y4M header"); }
+    return c!=EOF || !s.empty();
+  }
+  void header(){
+    std::string line; read_line(line);
+    std::string cs="420";
+    for(size_t i=0;i<line.size();){
+      size_t j=line.find(' ',i); if(j==std::string::npos) j=line.size();
+      std::string t=line.substr(i,j-i); i=j+1;
+      if(t.empty()) continue;
+      if(t[0]=='W') w_=std::atoi(t.c_str()+1);
+      else if(t[0]=='H') h_=std::atoi(t.c_str()+1);
+      else if(t[0]=='C') cs=t.substr(1);
+    }
+    if(w_<=0 || h_<=0) throw std::runtime_error("Bad Y4M size");
+    const size_t cw=((size_t)w_+1)/2, ch=((size_t)h_+1)/2;
+    if(cs=="mono") chroma_=0;
+    else if(cs.rfind("420",0)==0) chroma_=2*cw*ch;
+    else if(cs=="422") chroma_=2*cw*h_;
+    else if(cs=="444") chroma_=2*(size_t)w_*h_;
+    else if(cs=="444alpha") chroma_=3*(size_t)w_*h_;
+    else throw std::runtime_error("Unsupported Y4M colour space C"+cs+" (8-bit only)");
+  }
+
+  FILE* f_; bool y4m_=false; int w_=0, h_=0; size_t chroma_=0;
+  std::vector<uint8_t> carry_, skip_;
+};
+
+// ---------------- Repeat detection ----------------
+struct frame_hash {
+  std::array<uint64_t,4> bits{};
+  int distance(const frame_hash& o)const{ int d=0; for(int i=0;i<4;i++) d+=std::popcount(bits[i]^o.bits[i]); return d; }
+};
+// Block means on a 16×17 grid; bit = block brighter than the one to its
+// right by more than 2 levels. Codes differ in fine detail, not overall
+// brightness, so comparing neighbours (rather than the frame mean) keeps
+// two codes far apart, and the margin keeps sensor noise on flat areas
+// (quiet zone, finder patterns) from flipping bits.
+inline frame_hash hash_frame(const uint8_t* y,int w,int h){
+  constexpr int R=16, C=17;
+  std::array<uint64_t,R*C> sum{}; std::array<uint32_t,R*C> cnt{};
+  std::vector<uint8_t> bx((size_t)w); for(int x=0;x<w;x++) bx[x]=(uint8_t)((size_t)x*C/w);
+  for(int r=0;r<h;r++){
+    const uint8_t* row=y+(size_t)r*w; const int by=(int)((size_t)r*R/h)*C;
+    for(int x=0;x<w;x++){ sum[by+bx[x]]+=row[x]; cnt[by+bx[x]]++; }
+  }
+  frame_hash fh;
+  for(int r=0;r<R;r++) for(int c=0;c<C-1;c++){
+    int a=r*C+c, b=a+1;
+    if(cnt[a] && cnt[b] && sum[a]*cnt[b]>(sum[b]+2ull*cnt[b])*cnt[a]){ int k=r*(C-1)+c; fh.bits[k/64]|=1ull<<(k%64); }
+  }
+  return fh;
+}
+
+} // namespace gzqr
@@ -0,0 +1,93 @@
+#pragma once
+/*
+ * GitZipQR.cpp – library API (libgzqr)
+ *
+ * The encoder and decoder as in-process objects, for programs that would
+ * otherwise run MakeEncode/MakeDecode and go through files. Both stream:
+ * bytes go in as they arrive and codes come out as soon as they are
+ * rendered, and the other way round. One object handles any number of
+ * archives in turn and keeps its scrypt key and worker threads between them.
+ * Archives use the binary code format and decode with MakeDecode.
+ *
+ *   gzqr::Encoder enc(password);
+ *   enc.begin("report", ".pdf", [&](const gzqr::code_image& c){ save(c.name, c.png, c.pngSize); });
+ *   enc.write(data, size);
+ *   enc.finish();
+ *
+ *   gzqr::Decoder dec(password);
+ *   dec.begin([&](const uint8_t* p, size_t n){ out.append(p, n); });
+ *   for(auto& png : images) dec.add_png(png.data(), png.size());
+ *   gzqr::decode_info info = dec.finish();
+ *
+ * Link with libgzqr.a (or -lgzqr) and the libraries in the Makefile's LIBS.
+ */
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <istream>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace gzqr {
+
+// One finished code. The pointers are only valid during the callback.
+struct code_image {
+  const char* name;                   // the PNG name MakeEncode uses: qr-000012.png, qr-parity-000003.png, qr-manifest.png, qr-manifest-1.png
+  char kind;                          // 'D' data, 'P' parity, 'M' manifest
+  int index;                          // chunk, parity or manifest copy no
+  int size; const uint8_t* modules;   // size×size module matrix, bit 0 = dark, no quiet zone
+  const uint8_t* png; size_t pngSize; // rendered PNG; null when rendering is off
+};
+
+struct encoder_options {
+  std::string compress="auto";        // as --compress
+  std::string parity="off";           // as --parity
+  std::string png="gray1";            // gray1|rgba
+  bool render=true;                   // false: module matrices only, no PNG
+  int jobs=0;                         // worker threads, 0 = all cores
+};
+struct encode_summary { int chunks=0, parityCodes=0; uint64_t cipherBytes=0; };
+
+class Encoder {
+public:
+  using code_fn=std::function<void(const code_image&)>;
+  explicit Encoder(std::string password,encoder_options o={});
+  ~Encoder();
+  Encoder(const Encoder&)=delete; Encoder& operator=(const Encoder&)=delete;
+
+  // Starts an archive that decodes to name+ext. `onCode` runs on the worker
+  // threads, one call at a time; the manifest codes come last.
+  void begin(const std::string& name,const std::string& ext,code_fn onCode);
+  void write(const uint8_t* p,size_t n);
+  void write(std::istream& in);       // until EOF
+  // Returns once every code went through onCode. Errors, including ones
+  // thrown by onCode, come out of write() or finish() and end the archive.
+  encode_summary finish();
+
+private: struct impl; std::unique_ptr<impl> p_;
+};
+
+struct decode_info { std::string name, ext; uint64_t bytes=0; int rebuilt=0; };
+
+class Decoder {
+public:
+  using data_fn=std::function<void(const uint8_t*,size_t)>;
+  explicit Decoder(std::string password);
+  ~Decoder();
+  Decoder(const Decoder&)=delete; Decoder& operator=(const Decoder&)=delete;
+
+  // Starts an archive. Restored bytes reach `onData` in file order, from
+  // whichever add_* call completes them. They are only authenticated once
+  // finish() returns; if it throws, discard what was received.
+  void begin(data_fn onData);
+  // Codes may be added in any order, from several threads at once.
+  void add_png(const uint8_t* p,size_t n);
+  void add_image(const uint8_t* lum,int w,int h,size_t stride);   // 8-bit grayscale
+  void add_payload(std::string_view code);                         // bytes of one decoded code
+  decode_info finish();
+
+private: struct impl; std::unique_ptr<impl> p_;
+};
+
+} // namespace gzqr
@@ -0,0 +1,229 @@
+#pragma once
+/*
+ * GitZipQR.cpp – indexed archives (--indexed, MakeDecode --extract)
+ *
+ * The plaintext is the usual stream (a stored ZIP for directories), but
+ * instead of one compressor and one GCM stream over all of it, it is cut
+ * into segments of kIndexSegmentSize bytes, each compressed and sealed on
+ * its own. The ciphertext is a run of records:
+ *
+ *   u32 LE   sealed size | 0x80000000 on the last record
+ *   …        GCM(codec byte + compressed segment) + 16-byte tag
+ *
+ * Record i is sealed under the archive key with nonce = archive nonce whose
+ * last 4 bytes are XORed with i (big endian), and AAD = its 4-byte header +
+ * u32 LE i, so records can't be reordered, resized or cut off unnoticed.
+ * Records are self-delimiting: a full decode streams them in order like any
+ * other archive. Every segment but the last holds exactly the segment size.
+ *
+ * The table of contents lists each file with its place in the plaintext and
+ * the records covering it (first record index, ciphertext byte range). It
+ * is one more record, index kTocIndex, written as 'I' codes
+ * (qr-index-NNNNNN.png). --extract reads the manifest and index codes, then
+ * only the data codes in a file's ciphertext range, and opens only those
+ * records.
+ */
+#include "chunk_format.hpp"
+#include "stream.hpp"
+#include "compress.hpp"
+#include "zip_writer.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace gzqr::indexed {
+
+inline constexpr uint8_t kLayoutIndexed = 2;              // manifest tLayout value
+inline constexpr size_t kRecordHeader = 4;
+inline constexpr uint32_t kLastFlag = 0x80000000u, kTocIndex = 0xFFFFFFFFu;
+
+inline std::vector<uint8_t> nonce_for(const std::vector<uint8_t>& base,uint32_t i){
+  std::vector<uint8_t> n(base);
+  for(int k=0;k<4;k++) n[n.size()-1-k]^=(uint8_t)(i>>(8*k));
+  return n;
+}
+inline std::vector<uint8_t> aad_for(const uint8_t* hdr,uint32_t i){
+  std::vector<uint8_t> a(hdr,hdr+kRecordHeader); chunkfmt::put_u32(a,i); return a;
+}
+
+// ---------------- Records ----------------
+// Header + sealed segment. "auto" means deflate, as for incremental blocks;
+// a codec that doesn't shrink the segment falls back to storing it.
+inline std::vector<uint8_t> seal_record(const std::vector<uint8_t>& key,const std::vector<uint8_t>& nonce,uint32_t i,bool last,
+                                        const uint8_t* p,size_t n,const compress_opts& o){
+  int codec=o.autoSelect?kCodecDeflate:o.codec;
+  vector_sink z; z.data.push_back((uint8_t)codec);
+  { auto c=make_compressor(codec,o.autoSelect?-1:o.level,z); c->write(p,n); c->finish(); }
+  if(codec!=kCodecNone && z.data.size()>n){ z.data.assign(1,(uint8_t)kCodecNone); z.data.insert(z.data.end(),p,p+n); }
+  vector_sink r; chunkfmt::put_u32(r.data,(uint32_t)(z.data.size()+16)|(last?kLastFlag:0));
+  const std::vector<uint8_t> aad=aad_for(r.data.data(),i);
+  { gcm_encrypt_sink e(key,nonce_for(nonce,i),aad,r); e.write(z.data.data(),z.data.size()); e.finish(); }
+  return std::move(r.data);
+}
+// Inverse of seal_record: `hdr` is the record header, `sealed` what follows it.
+inline std::vector<uint8_t> open_record(const std::vector<uint8_t>& key,const std::vector<uint8_t>& nonce,uint32_t i,
+                                        const uint8_t* hdr,const uint8_t* sealed,size_t n){
+  vector_sink body;
+  { gcm_decrypt_sink d(key,nonce_for(nonce,i),aad_for(hdr,i),body); d.write(sealed,n); d.finish(); }
+  if(body.data.empty()) throw std::runtime_error("empty segment");
+  vector_sink out;
+  { auto u=make_decompressor(body.data[0],out); u->write(body.data.data()+1,body.data.size()-1); u->finish(); }
+  return std::move(out.data);
+}
+
+// Cuts record headers and bodies out of a byte stream, whatever the block
+// boundaries; `on_record(header, sealed, n)` sees every whole record.
+class record_splitter {
+public:
+  explicit record_splitter(size_t maxSealed):max_(maxSealed){}
+  template<class F> void feed(const uint8_t* p,size_t n,F&& on_record){
+    buf_.insert(buf_.end(),p,p+n);
+    size_t at=0;
+    while(buf_.size()-at>=kRecordHeader){
+      const size_t len=chunkfmt::get_u32(&buf_[at])&~kLastFlag;
+      if(len<17 || len>max_) throw std::runtime_error("Bad segment record");
+      if(buf_.size()-at<kRecordHeader+len) break;
+      on_record(&buf_[at],&buf_[at+kRecordHeader],len);
+      at+=kRecordHeader+len;
+    }
+    buf_.erase(buf_.begin(),buf_.begin()+at);
+  }
+  bool empty()const{ return buf_.empty(); }
+private: size_t max_; std::vector<uint8_t> buf_;
+};
+// Largest sealed size of a segment: codec byte + stored data + tag.
+inline size_t max_sealed(size_t segment){ return segment+1+16; }
+
+// ---------------- Encoder ----------------
+// Plaintext in, records out. Remembers where each record starts so the
+// table of contents can point into the ciphertext.
+class segment_sink : public byte_sink {
+public:
+  segment_sink(const std::vector<uint8_t>& key,const std::vector<uint8_t>& nonce,size_t segment,const compress_opts& o,byte_sink& next)
+    :key_(key),nonce_(nonce),size_(segment),o_(o),next_(next){ buf_.reserve(size_); }
+  void write(const uint8_t* p,size_t n)override{
+    while(n>0){
+      if(buf_.size()==size_) seal(false);   // only now is it known not to be the last
+      size_t k=std::min(n,size_-buf_.size());
+      buf_.insert(buf_.end(),p,p+k); p+=k; n-=k; bytes_+=k;
+    }
+  }
+  void finish()override{ seal(true); next_.finish(); }
+
+  uint64_t bytes()const{ return bytes_; }
+  size_t segment()const{ return size_; }
+  // Where plaintext [offset, offset+size) lives: first record and ciphertext range.
+  void locate(uint64_t offset,uint64_t size,uint32_t& first,uint64_t& begin,uint64_t& end)const{
+    if(!size){ first=0; begin=end=0; return; }
+    first=(uint32_t)(offset/size_);
+    const size_t last=(size_t)((offset+size-1)/size_);
+    begin=starts_.at(first); end=last+1<starts_.size()?starts_[last+1]:pos_;
+  }
+
+private:
+  void seal(bool last){
+    if(starts_.size()>=kTocIndex) throw std::runtime_error("Archive too large for --indexed");
+    auto r=seal_record(key_,nonce_,(uint32_t)starts_.size(),last,buf_.data(),buf_.size(),o_);
+    starts_.push_back(pos_); pos_+=r.size();
+    next_.write(r.data(),r.size()); buf_.clear();
+  }
+  std::vector<uint8_t> key_, nonce_; size_t size_; compress_opts o_; byte_sink& next_;
+  std::vector<uint8_t> buf_; std::vector<uint64_t> starts_; uint64_t pos_=0, bytes_=0;
+};
+
+// ---------------- Decoder ----------------
+// Records in (a full decode), plaintext out. finish() throws unless the
+// last record came through and nothing followed it.
+class segment_open_sink : public byte_sink {
+public:
+  segment_open_sink(const std::vector<uint8_t>& key,const std::vector<uint8_t>& nonce,size_t segment,byte_sink& next)
+    :key_(key),nonce_(nonce),size_(segment),split_(max_sealed(segment)),next_(next){}
+  void write(const uint8_t* p,size_t n)override{
+    split_.feed(p,n,[&](const uint8_t* hdr,const uint8_t* sealed,size_t len){
+      if(last_) throw std::runtime_error("data after the last segment");
+      auto plain=open_record(key_,nonce_,next_index_++,hdr,sealed,len);
+      last_=(chunkfmt::get_u32(hdr)&kLastFlag)!=0;
+      if(!last_ ? plain.size()!=size_ : plain.size()>size_) throw std::runtime_error("segment size mismatch");
+      next_.write(plain.data(),plain.size());
+    });
+  }
+  void finish()override{
+    if(!last_ || !split_.empty()) throw std::runtime_error("truncated segments");
+    next_.finish();
+  }
+private:
+  std::vector<uint8_t> key_, nonce_; size_t size_; record_splitter split_; byte_sink& next_;
+  uint32_t next_index_=0; bool last_=false;
+};
+
+// ---------------- Table of contents ----------------
+// One file: plaintext [offset, offset+size), covered by the records from
+// `first` on, which span ciphertext [begin, end). Empty files have begin == end.
+struct toc_entry { std::string name; uint64_t offset=0, size=0; uint32_t first=0; uint64_t begin=0, end=0; };
+
+// u32 count, then per entry: u16 name length, name, u64 offset, u64 size, u32 first, u64 begin, u64 end (LE).
+inline std::vector<uint8_t> toc_bytes(const std::vector<toc_entry>& t){
+  std::vector<uint8_t> o;
+  auto num=[&](uint64_t v,int n){ for(int k=0;k<n;k++) o.push_back((uint8_t)(v>>(8*k))); };
+  num(t.size(),4);
+  for(const auto& e:t){
+    if(e.name.size()>0xFFFF) throw std::runtime_error("path too long for index: "+e.name);
+    num(e.name.size(),2); o.insert(o.end(),e.name.begin(),e.name.end());
+    num(e.offset,8); num(e.size,8); num(e.first,4); num(e.begin,8); num(e.end,8);
+  }
+  return o;
+}
+inline std::vector<toc_entry> parse_toc(const std::vector<uint8_t>& b){
+  size_t i=0;
+  auto num=[&](int n)->uint64_t{
+    if(i+n>b.size()) throw std::runtime_error("index truncated");
+    uint64_t v=0; for(int k=n-1;k>=0;k--) v=(v<<8)|b[i+k]; i+=n; return v; };
+  std::vector<toc_entry> t((size_t)std::min<uint64_t>(num(4),b.size()/38));
+  for(auto& e:t){
+    size_t len=(size_t)num(2); if(i+len>b.size()) throw std::runtime_error("index truncated");
+    e.name.assign((const char*)&b[i],len); i+=len;
+    e.offset=num(8); e.size=num(8); e.first=(uint32_t)num(4); e.begin=num(8); e.end=num(8);
+  }
+  return t;
+}
+
+inline std::vector<toc_entry> make_toc(const std::vector<zip_member>& members,const segment_sink& s){
+  std::vector<toc_entry> t;
+  for(const auto& m:members){ toc_entry e{m.name,m.offset,m.size}; s.locate(m.offset,m.size,e.first,e.begin,e.end); t.push_back(e); }
+  return t;
+}
+inline std::vector<uint8_t> seal_toc(const std::vector<uint8_t>& key,const std::vector<uint8_t>& nonce,const std::vector<toc_entry>& t){
+  auto b=toc_bytes(t); return seal_record(key,nonce,kTocIndex,true,b.data(),b.size(),compress_opts{});
+}
+inline std::vector<toc_entry> open_toc(const std::vector<uint8_t>& key,const std::vector<uint8_t>& nonce,const std::vector<uint8_t>& rec){
+  if(rec.size()<kRecordHeader || (chunkfmt::get_u32(rec.data())&~kLastFlag)!=rec.size()-kRecordHeader) throw std::runtime_error("index truncated");
+  return parse_toc(open_record(key,nonce,kTocIndex,rec.data(),rec.data()+kRecordHeader,rec.size()-kRecordHeader));
+}
+
+// ---------------- Extraction ----------------
+// Ciphertext [e.begin, e.end) in, the file's bytes out.
+class entry_sink : public byte_sink {
+public:
+  entry_sink(const std::vector<uint8_t>& key,const std::vector<uint8_t>& nonce,size_t segment,const toc_entry& e,byte_sink& next)
+    :key_(key),nonce_(nonce),size_(segment),e_(e),split_(max_sealed(segment)),next_(next),seg_(e.first){}
+  void write(const uint8_t* p,size_t n)override{
+    split_.feed(p,n,[&](const uint8_t* hdr,const uint8_t* sealed,size_t len){
+      auto plain=open_record(key_,nonce_,seg_,hdr,sealed,len);
+      const uint64_t at=(uint64_t)seg_++*size_;
+      const uint64_t lo=std::max(at,e_.offset), hi=std::min(at+plain.size(),e_.offset+e_.size);
+      if(hi>lo){ next_.write(plain.data()+(lo-at),(size_t)(hi-lo)); out_+=hi-lo; }
+    });
+  }
+  void finish()override{
+    if(out_!=e_.size || !split_.empty()) throw std::runtime_error("Index entry doesn't match the archive: "+e_.name);
+    next_.finish();
+  }
+private:
+  std::vector<uint8_t> key_, nonce_; size_t size_; toc_entry e_; record_splitter split_; byte_sink& next_;
+  uint32_t seg_; uint64_t out_=0;
+};
+
+} // namespace gzqr::indexed
@@ -0,0 +1,174 @@
+/*
+ * GitZipQR.cpp – libgzqr (see gzqr.hpp)
+ * License: MIT
+ *
+ * Thin objects over the same cores as the command-line tools:
+ * archive_writer.hpp for encoding and assembler.hpp for decoding. Key
+ * handling follows batch mode: scrypt runs once per Encoder and every
+ * archive gets its own key through HKDF, plus its own nonce.
+ */
+
+#include "gzqr.hpp"
+#include "common.hpp"
+#include "config.hpp"
+#include "pool.hpp"
+#include "archive_writer.hpp"
+#include "assembler.hpp"
+#include "png_writer.hpp"
+#include "qr_capacity.hpp"
+
+#include <atomic>
+#include <mutex>
+#include <qrencode.h>
+
+namespace gzqr {
+
+static int lib_ecl(){
+  switch(gzqr_config::kDefaultQRECL){ case 'L': return QR_ECLEVEL_L; case 'M': return QR_ECLEVEL_M; case 'H': return QR_ECLEVEL_H; default: return QR_ECLEVEL_Q; }
+}
+
+// ---------------- Encoder ----------------
+struct Encoder::impl {
+  std::string pass; encoder_options o;
+  compress_opts comp; parity_opts par; png_opts png;
+  int version=gzqr_config::kDefaultQRVersion, ecl=lib_ecl(), margin=gzqr_config::kDefaultQRMargin, scale=gzqr_config::kDefaultQRScale;
+  size_t chunkSize=0; unsigned jobs=1;
+  std::vector<uint8_t> key, salt;          // scrypt, on the first archive
+  std::unique_ptr<worker_pool> pool;
+
+  // Current archive.
+  std::string name, ext; std::vector<uint8_t> keySalt;
+  code_fn onCode; std::mutex cbMu;
+  std::unique_ptr<archive_writer> w;
+
+  void render(char kind,int index,const std::vector<uint8_t>& payload){
+    char fn[64];
+    if(kind==chunkfmt::kManifest) std::snprintf(fn,sizeof(fn),"%s",chunkfmt::manifest_png(index).c_str());
+    else std::snprintf(fn,sizeof(fn),kind==chunkfmt::kParity?"qr-parity-%06d.png":"qr-%06d.png",index);
+    QRcode* q;
+    { stat_scope sc(stQrEncode,payload.size(),true); q=QRcode_encodeData((int)payload.size(),payload.data(),version,(QRecLevel)ecl); }
+    if(!q) throw std::runtime_error("Internal error: calibrated payload did not fit");
+    try{
+      std::vector<uint8_t> img;
+      if(o.render){ stat_scope sc(stPngWrite,payload.size(),true); write_qr_png(img,q->data,q->width,margin,scale,png); }
+      code_image c{fn,kind,index,q->width,q->data,img.empty()?nullptr:img.data(),img.size()};
+      std::lock_guard<std::mutex> lk(cbMu); onCode(c);
+    }catch(...){ QRcode_free(q); throw; }
+    QRcode_free(q);
+  }
+  void submit(uint8_t kind,int index,std::vector<uint8_t> body){
+    pool->submit([this,kind,index,body=std::move(body)]{
+      chunkfmt::header h; h.kind=kind; h.index=(uint32_t)index;
+      std::vector<uint8_t> payload;
+      { stat_scope sc(stChunkBuild,body.size()); payload=chunkfmt::build(h,body.data(),body.size()); }
+      render((char)kind,index,payload);
+    });
+  }
+  // Ends the current archive after an error; the pool's error is sticky, so it is replaced.
+  void abort(){
+    if(pool){ try{ pool->wait(); }catch(...){} pool=std::make_unique<worker_pool>(jobs,(size_t)jobs*gzqr_config::kQueuedChunksPerJob); }
+    w.reset(); onCode=nullptr;
+  }
+};
+
+Encoder::Encoder(std::string password,encoder_options o):p_(std::make_unique<impl>()){
+  if(password.size()<8) throw std::runtime_error("Password >=8 required");
+  p_->pass=std::move(password); p_->o=std::move(o);
+  if(!parse_compress(p_->o.compress,p_->comp)) throw std::runtime_error("Bad compress option");
+  if(!parse_parity(p_->o.parity,gzqr_config::kDefaultParityGroup,p_->par)) throw std::runtime_error("Bad parity option");
+  if(!parse_png_mode(p_->o.png,p_->png.mode)) throw std::runtime_error("Bad png option");
+  parse_png_strategy(gzqr_config::kDefaultPngStrategy,p_->png.zstrategy); parse_png_filter(gzqr_config::kDefaultPngFilter,p_->png.filter);
+  p_->png.zlevel=gzqr_config::kDefaultPngZLevel;
+  p_->chunkSize=(size_t)std::max(64,chunk_capacity(p_->version,p_->ecl,chunkfmt::kHeaderSize,false));
+  p_->jobs=resolve_jobs(p_->o.jobs);
+  p_->pool=std::make_unique<worker_pool>(p_->jobs,(size_t)p_->jobs*gzqr_config::kQueuedChunksPerJob);
+}
+Encoder::~Encoder(){ if(p_->w) p_->abort(); }
+
+void Encoder::begin(const std::string& name,const std::string& ext,code_fn onCode){
+  impl& d=*p_;
+  if(d.w) throw std::runtime_error("Encoder: archive already open");
+  if(d.key.empty()){
+    d.salt.resize(16); RAND_bytes(d.salt.data(),16);
+    stat_scope sc(stKdf); d.key=scrypt_kdf(d.pass,d.salt,{(1u<<15),8u,(uint32_t)std::max(1u,std::thread::hardware_concurrency())});
+  }
+  std::vector<uint8_t> nonce(12); d.keySalt.assign(16,0);
+  RAND_bytes(d.keySalt.data(),16); RAND_bytes(nonce.data(),12);
+  auto key=hkdf_sha256(d.key,d.keySalt,std::string(gzqr_config::kProjectName)+" archive key");
+  d.name=name; d.ext=ext; d.onCode=std::move(onCode);
+  d.w=std::make_unique<archive_writer>(d.comp,d.par,d.chunkSize,key,nonce,
+    [&d](uint8_t kind,int i,std::vector<uint8_t> body){ d.submit(kind,i,std::move(body)); });
+}
+
+void Encoder::write(const uint8_t* p,size_t n){
+  if(!p_->w) throw std::runtime_error("Encoder: no archive (call begin)");
+  try{ stat_scope sc(stInput); p_->w->write(p,n); }catch(...){ p_->abort(); throw; }
+}
+void Encoder::write(std::istream& in){
+  std::vector<uint8_t> b(1<<20);
+  while(in){
+    in.read((char*)b.data(),(std::streamsize)b.size());
+    if(in.gcount()>0) write(b.data(),(size_t)in.gcount());
+  }
+}
+
+encode_summary Encoder::finish(){
+  impl& d=*p_;
+  if(!d.w) throw std::runtime_error("Encoder: no archive (call begin)");
+  encode_summary s;
+  try{
+    d.w->finish(); d.pool->wait();
+    chunkfmt::manifest m=d.w->manifest();
+    m.salt=d.salt; m.keySalt=d.keySalt; m.name=d.name; m.ext=d.ext;
+    if((int)manifest_code(m,d.w->chunks()).size()>qr_byte_capacity(d.version,d.ecl)) throw std::runtime_error("Name too long for manifest code");
+    for(int c=0;c<chunkfmt::kManifestCopies;c++) d.render(chunkfmt::kManifest,c,manifest_code(m,d.w->chunks(),c));
+    s.chunks=d.w->chunks(); s.parityCodes=d.w->parity_codes(); s.cipherBytes=m.cipherSize;
+  }catch(...){ d.abort(); throw; }
+  d.w.reset(); d.onCode=nullptr;
+  return s;
+}
+
+// ---------------- Decoder ----------------
+struct Decoder::impl {
+  explicit impl(std::string pass):keys(std::move(pass)){}
+  key_cache keys;                           // kept across archives
+  std::unique_ptr<stream_assembler> table;
+  std::atomic<uint64_t> bytes{0};
+  stream_assembler& cur(){ if(!table) throw std::runtime_error("Decoder: no archive (call begin)"); return *table; }
+};
+
+Decoder::Decoder(std::string password){
+  if(password.size()<8) throw std::runtime_error("Password >=8 required");
+  p_=std::make_unique<impl>(std::move(password));
+}
+Decoder::~Decoder()=default;
+
+void Decoder::begin(data_fn onData){
+  if(p_->table) throw std::runtime_error("Decoder: archive already open");
+  p_->bytes=0;
+  p_->table=std::make_unique<stream_assembler>([d=p_.get(),f=std::move(onData)](const uint8_t* p,size_t n){ d->bytes+=n; f(p,n); },p_->keys);
+}
+void Decoder::add_png(const uint8_t* p,size_t n){
+  stream_assembler& t=p_->cur(); raster r;
+  { stat_scope sc(stPngRead,n,true); r=png_read(p,n); }
+  scan_image(r,t,nullptr);
+}
+void Decoder::add_image(const uint8_t* lum,int w,int h,size_t stride){
+  stream_assembler& t=p_->cur();
+  if(w<=0 || h<=0 || stride<(size_t)w) throw std::runtime_error("Decoder: bad image size");
+  raster r; r.w=w; r.h=h; r.channels=1; r.px.resize((size_t)w*h);
+  for(int y=0;y<h;y++) std::memcpy(&r.px[(size_t)y*w],lum+(size_t)y*stride,(size_t)w);
+  scan_image(r,t,nullptr);
+}
+void Decoder::add_payload(std::string_view code){ scan_payload(code,p_->cur(),nullptr); }
+
+decode_info Decoder::finish(){
+  stream_assembler& t=p_->cur();
+  decode_info i;
+  try{ t.finish(); }catch(...){ p_->table.reset(); throw; }
+  i.name=t.meta().nameBase; i.ext=t.meta().metaExt; i.bytes=p_->bytes; i.rebuilt=t.rebuilt();
+  p_->table.reset();
+  return i;
+}
+
+} // namespace gzqr
@@ -0,0 +1,119 @@
+#pragma once
+/*
+ * GitZipQR.cpp – colour-multiplexed codes (--rgb)
+ *
+ * Three codes share one image, one per colour channel: chunk i goes to
+ * image i/3, plane i%3 (R, G, B). Each channel is 0 where its code has a
+ * dark module and 255 elsewhere, so every pixel is one of the eight corners
+ * of the RGB cube (white, black, cyan/magenta/yellow where one code is dark,
+ * red/green/blue where two are). Those colours survive palette reduction
+ * and print as plain CMY ink combinations. A code's plane is also recorded
+ * in its header flags (chunk_format.hpp), so image and plane of any chunk
+ * follow from its index.
+ *
+ * The decoder splits a colour image into three grayscale planes and reads
+ * each one as usual, including the pristine fast path for images we wrote.
+ * All three codes must have the same version (the encoder enforces it).
+ */
+#include "chunk_format.hpp"
+#include "png_writer.hpp"
+#include "qr_reader.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <qrencode.h>
+
+namespace gzqr {
+
+inline constexpr int kPlanes = 3;
+
+// Header flags of a code on plane p (0..2); 0 means a code with its own image.
+inline uint8_t plane_flags(int p){ return (uint8_t)(p+1); }
+inline int plane_of(const chunkfmt::header& h){ return (h.flags&3)-1; }
+
+// ---------------- Writer ----------------
+// Collects codes from any worker; an image is written by the worker that
+// adds its third code, and finish() writes the partial last one.
+class plane_writer {
+public:
+  // Images are written as <prefix>-%06d.png.
+  plane_writer(int qsize,int margin,int scale,std::string outdir,png_opts o,std::string prefix="qr-rgb")
+  :qsize_(qsize),margin_(margin),scale_(scale),outdir_(std::move(outdir)),prefix_(std::move(prefix)),o_(o){}
+  ~plane_writer(){ for(auto& [k,p]:pending_) for(auto* q:p.codes) if(q) QRcode_free(q); }
+
+  // Takes ownership of q.
+  void place(int chunk,QRcode* q){
+    if(q->width!=qsize_){ QRcode_free(q); throw std::runtime_error("rgb plane size mismatch"); }
+    int img=chunk/kPlanes;
+    std::array<QRcode*,kPlanes> full{};
+    {
+      std::lock_guard<std::mutex> lk(m_);
+      auto& p=pending_[img]; p.codes[chunk%kPlanes]=q;
+      if(++p.filled<kPlanes) return;
+      full=p.codes; pending_.erase(img);
+    }
+    write(img,full);
+  }
+  void finish(){
+    std::map<int,pending> left; { std::lock_guard<std::mutex> lk(m_); left.swap(pending_); }
+    for(auto& [img,p]:left) write(img,p.codes);
+  }
+  int images()const{ return written_; }
+
+private:
+  struct pending { std::array<QRcode*,kPlanes> codes{}; int filled=0; };
+
+  // 8-bit RGB; a missing plane stays white.
+  void write(int img,std::array<QRcode*,kPlanes>& codes){
+    struct guard { std::array<QRcode*,kPlanes>& v; ~guard(){ for(auto*& q:v) if(q){ QRcode_free(q); q=nullptr; } } } g{codes};
+    const int S=scale_, W=(qsize_+2*margin_)*S;
+    std::vector<uint8_t> blank((size_t)W*3,0xFF), line(blank.size());
+    int built=-1;
+    auto row=[&](int y)->const uint8_t*{
+      int my=y/S-margin_;
+      if(my<0 || my>=qsize_) return blank.data();
+      if(my!=built){
+        built=my; std::memcpy(line.data(),blank.data(),line.size());
+        for(int p=0;p<kPlanes;p++) if(codes[p]){
+          const unsigned char* m=codes[p]->data+(size_t)my*qsize_;
+          for(int mx=0;mx<qsize_;mx++) if(m[mx]&1){
+            uint8_t* px=&line[((size_t)(margin_+mx)*S)*3+p];
+            for(int k=0;k<S;k++) px[(size_t)k*3]=0;
+          }
+        }
+      }
+      return line.data();
+    };
+    char fn[32]; std::snprintf(fn,sizeof(fn),"-%06d.png",img);
+    write_png_rows((std::filesystem::path(outdir_)/(prefix_+fn)).string(),W,W,PNG_COLOR_TYPE_RGB,8,row,o_);
+    std::lock_guard<std::mutex> lk(m_); written_++;
+  }
+
+  int qsize_, margin_, scale_; std::string outdir_, prefix_; png_opts o_;
+  std::mutex m_; std::map<int,pending> pending_; int written_=0;
+};
+
+// ---------------- Reader ----------------
+// True if some pixel's channels differ (a plain gray image in RGBA is not).
+inline bool is_colour(const raster& r){
+  if(r.channels<3) return false;
+  const uint8_t* p=r.px.data(); const size_t n=(size_t)r.w*r.h;
+  for(size_t i=0;i<n;i++,p+=r.channels) if(p[0]!=p[1] || p[1]!=p[2]) return true;
+  return false;
+}
+// Channel c as a grayscale raster; false if it is blank (no dark pixel).
+inline bool split_plane(const raster& r,int c,raster& out){
+  out.w=r.w; out.h=r.h; out.channels=1; out.px.resize((size_t)r.w*r.h);
+  const uint8_t* p=r.px.data()+c; uint8_t lo=255;
+  for(auto& v:out.px){ v=*p; lo=std::min(lo,v); p+=r.channels; }
+  return lo<128;
+}
+
+} // namespace gzqr
@@ -0,0 +1,123 @@
+#pragma once
+/*
+ * GitZipQR.cpp – QR PNG writer
+ *
+ * QR codes are pure black/white, so the default mode writes 1-bit grayscale:
+ * each module row is expanded once into a packed scanline (runs of `scale`
+ * pixels, whole bytes via memset) and that same scanline is handed to libpng
+ * `scale` times. No full-image buffer is ever built. The legacy 8-bit RGBA
+ * mode uses the same row-repeat scheme and produces the same bytes as the
+ * old per-pixel writer. zlib level/strategy and the PNG row filter are
+ * tunable; defaults live in config.hpp. Output goes to a file or, for the
+ * library, to a memory buffer.
+ */
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <png.h>
+#include <zlib.h>
+
+namespace gzqr {
+
+enum png_mode { kPngRGBA = 0, kPngGray1 = 1 };
+
+struct png_opts {
+  int mode = kPngGray1;
+  int zlevel = -1;       // 0..9, -1 = libpng default
+  int zstrategy = -1;    // Z_DEFAULT_STRATEGY, Z_FILTERED, Z_HUFFMAN_ONLY, Z_RLE, Z_FIXED; -1 = libpng default
+  int filter = -1;       // PNG_FILTER_* mask, -1 = libpng default
+};
+
+inline bool parse_png_mode(const std::string& s,int& mode){
+  if(s=="gray1"||s=="1bit") mode=kPngGray1; else if(s=="rgba") mode=kPngRGBA; else return false;
+  return true;
+}
+inline bool parse_png_strategy(const std::string& s,int& st){
+  if(s=="auto") st=-1; else if(s=="default") st=Z_DEFAULT_STRATEGY; else if(s=="filtered") st=Z_FILTERED; else if(s=="huffman") st=Z_HUFFMAN_ONLY;
+  else if(s=="rle") st=Z_RLE; else if(s=="fixed") st=Z_FIXED; else return false;
+  return true;
+}
+inline bool parse_png_filter(const std::string& s,int& f){
+  if(s=="default") f=-1; else if(s=="none") f=PNG_FILTER_NONE; else if(s=="sub") f=PNG_FILTER_SUB; else if(s=="up") f=PNG_FILTER_UP;
+  else if(s=="avg") f=PNG_FILTER_AVG; else if(s=="paeth") f=PNG_FILTER_PAETH; else if(s=="all") f=PNG_ALL_FILTERS; else return false;
+  return true;
+}
+
+// Where PNG bytes go: a file (`out`) or, when `mem` is set, the end of *mem.
+struct png_target {
+  png_target(std::string path):out(std::move(path)){}
+  png_target(std::vector<uint8_t>& buf):mem(&buf){}
+  std::string out; std::vector<uint8_t>* mem=nullptr;
+};
+
+// Streams `h` rows of a w×h image; row(y) must stay valid until the next call.
+inline void write_png_rows(const png_target& t,int w,int h,int colorType,int bitDepth,
+                           const std::function<const uint8_t*(int)>& row,const png_opts& o){
+  FILE* const fp=t.mem?nullptr:fopen(t.out.c_str(),"wb");
+  if(!t.mem && !fp) throw std::runtime_error("open png");
+  png_structp png_ptr=png_create_write_struct(PNG_LIBPNG_VER_STRING,nullptr,nullptr,nullptr);
+  png_infop info_ptr=png_ptr?png_create_info_struct(png_ptr):nullptr;
+  if(!info_ptr){ png_destroy_write_struct(&png_ptr,nullptr); if(fp) fclose(fp); throw std::runtime_error("png_write_struct"); }
+  if(setjmp(png_jmpbuf(png_ptr))){ png_destroy_write_struct(&png_ptr,&info_ptr); if(fp) fclose(fp); throw std::runtime_error("png write"); }
+  if(fp) png_init_io(png_ptr,fp);
+  else png_set_write_fn(png_ptr,t.mem,[](png_structp p,png_bytep d,png_size_t n){
+    auto* v=(std::vector<uint8_t>*)png_get_io_ptr(p); v->insert(v->end(),d,d+n); },nullptr);
+  if(o.zlevel>=0) png_set_compression_level(png_ptr,o.zlevel);
+  if(o.zstrategy>=0) png_set_compression_strategy(png_ptr,o.zstrategy);
+  if(o.filter>=0) png_set_filter(png_ptr,PNG_FILTER_TYPE_BASE,o.filter);
+  png_set_IHDR(png_ptr,info_ptr,w,h,bitDepth,colorType,PNG_INTERLACE_NONE,PNG_COMPRESSION_TYPE_DEFAULT,PNG_FILTER_TYPE_DEFAULT);
+  png_write_info(png_ptr,info_ptr);
+  for(int y=0;y<h;y++) png_write_row(png_ptr,(png_const_bytep)row(y));
+  png_write_end(png_ptr,nullptr);
+  png_destroy_write_struct(&png_ptr,&info_ptr); if(fp) fclose(fp);
+}
+
+// Clears the pixels of every dark module in one module row (m, qsize wide)
+// on a white scanline, starting at pixel x `xoff`. 1-bit lines are packed
+// MSB-first, and whole bytes are cleared with memset.
+inline void paint_module_row(uint8_t* line,const unsigned char* m,int qsize,size_t xoff,int scale,bool gray1){
+  for(int mx=0;mx<qsize;){
+    if(!(m[mx]&1)){ mx++; continue; }
+    int end=mx; while(end<qsize && (m[end]&1)) end++;
+    size_t x0=xoff+(size_t)mx*scale, x1=xoff+(size_t)end*scale;
+    if(gray1){
+      for(;x0<x1 && (x0&7);x0++) line[x0>>3]&=~(0x80>>(x0&7));
+      if(x0+8<=x1){ size_t nb=(x1-x0)>>3; std::memset(&line[x0>>3],0x00,nb); x0+=nb<<3; }
+      for(;x0<x1;x0++) line[x0>>3]&=~(0x80>>(x0&7));
+    } else {
+      for(size_t x=x0;x<x1;x++){ uint8_t* p=&line[x*4]; p[0]=p[1]=p[2]=0; }
+    }
+    mx=end;
+  }
+}
+inline size_t png_stride(int w,const png_opts& o){ return o.mode==kPngGray1?((size_t)w+7)/8:(size_t)w*4; }
+inline void write_png_lines(const png_target& out,int w,int h,const std::function<const uint8_t*(int)>& row,const png_opts& o){
+  if(o.mode==kPngGray1) write_png_rows(out,w,h,PNG_COLOR_TYPE_GRAY,1,row,o);
+  else                  write_png_rows(out,w,h,PNG_COLOR_TYPE_RGBA,8,row,o);
+}
+
+// `modules` is libqrencode's qsize×qsize matrix (bit 0 = dark).
+inline void write_qr_png(const png_target& out,const unsigned char* modules,int qsize,int margin,int scale,const png_opts& o){
+  if(!modules) throw std::runtime_error("QRcode is null");
+  const int img_size=(qsize+2*margin)*scale;
+  const size_t stride=png_stride(img_size,o);
+  std::vector<uint8_t> blank(stride,0xFF), line(stride);
+  int built=-1;
+  auto row=[&](int y)->const uint8_t*{
+    int my=y/scale-margin;
+    if(my<0||my>=qsize) return blank.data();
+    if(my!=built){
+      std::memcpy(line.data(),blank.data(),stride);
+      paint_module_row(line.data(),modules+(size_t)my*qsize,qsize,(size_t)margin*scale,scale,o.mode==kPngGray1);
+      built=my;
+    }
+    return line.data();
+  };
+  write_png_lines(out,img_size,img_size,row,o);
+}
+
+} // namespace gzqr
@@ -0,0 +1,84 @@
+#pragma once
+/*
+ * GitZipQR.cpp – worker pool
+ *
+ * Fixed set of threads fed through a bounded job queue: submit() blocks once
+ * `max_queued` jobs are waiting, so a fast producer (file reader) can never
+ * run ahead of the QR/PNG workers and memory stays flat. The first exception
+ * thrown by a job is kept and rethrown from submit()/wait().
+ *
+ * One FIFO shared by all workers: whoever is free takes the oldest job, so
+ * a few slow images (ZXing on a noisy photo) never leave other cores idle,
+ * and jobs start in submission order, which keeps the decoder's in-order
+ * assembler from holding chunks that ran ahead.
+ */
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace gzqr {
+
+inline unsigned resolve_jobs(int requested){
+  if(requested>0) return (unsigned)requested;
+  return std::max(1u,std::thread::hardware_concurrency());
+}
+
+class worker_pool {
+public:
+  worker_pool(unsigned threads,size_t max_queued):cap_(std::max<size_t>(1,max_queued)){
+    for(unsigned i=0;i<std::max(1u,threads);i++) th_.emplace_back([this]{ run(); });
+  }
+  ~worker_pool(){
+    { std::lock_guard<std::mutex> lk(m_); stop_=true; }
+    cv_job_.notify_all(); for(auto& t:th_) t.join();
+  }
+  worker_pool(const worker_pool&)=delete; worker_pool& operator=(const worker_pool&)=delete;
+
+  unsigned size()const{ return (unsigned)th_.size(); }
+
+  void submit(std::function<void()> job){
+    std::unique_lock<std::mutex> lk(m_);
+    cv_space_.wait(lk,[&]{ return q_.size()<cap_ || err_; });
+    if(err_) rethrow(lk);
+    q_.push_back(std::move(job)); ++pending_;
+    lk.unlock(); cv_job_.notify_one();
+  }
+  // Blocks until every submitted job finished; rethrows the first job error.
+  void wait(){
+    std::unique_lock<std::mutex> lk(m_);
+    cv_idle_.wait(lk,[&]{ return pending_==0; });
+    if(err_) rethrow(lk);
+  }
+
+private:
+  void run(){
+    for(;;){
+      std::function<void()> job;
+      { std::unique_lock<std::mutex> lk(m_);
+        cv_job_.wait(lk,[&]{ return stop_ || !q_.empty(); });
+        if(q_.empty()) return;
+        job=std::move(q_.front()); q_.pop_front(); }
+      cv_space_.notify_one();
+      std::exception_ptr ep;
+      if(!failed()){ try{ job(); }catch(...){ ep=std::current_exception(); } }
+      { std::lock_guard<std::mutex> lk(m_);
+        if(ep && !err_) err_=ep;
+        if(--pending_==0) cv_idle_.notify_all(); }
+      if(ep) cv_space_.notify_all();
+    }
+  }
+  bool failed(){ std::lock_guard<std::mutex> lk(m_); return (bool)err_; }
+  [[noreturn]] void rethrow(std::unique_lock<std::mutex>& lk){ auto e=err_; lk.unlock(); std::rethrow_exception(e); }
+
+  std::vector<std::thread> th_;
+  std::deque<std::function<void()>> q_;
+  std::mutex m_; std::condition_variable cv_job_,cv_space_,cv_idle_;
+  size_t cap_; size_t pending_=0; bool stop_=false; std::exception_ptr err_;
+};
+
+} // namespace gzqr
@@ -0,0 +1,52 @@
+#pragma once
+/*
+ * GitZipQR.cpp – QR capacity model
+ *
+ * Closed-form byte-mode capacity from the ISO/IEC 18004 data codeword table
+ * (the same numbers libqrencode uses internally), so chunk sizes no longer
+ * have to be found by trial-encoding dummy payloads. Columns follow
+ * libqrencode's QRecLevel order: L, M, Q, H.
+ */
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <tuple>
+
+namespace gzqr {
+
+inline constexpr int kDataCodewords[41][4] = {
+  {0,0,0,0},
+  {19,16,13,9},{34,28,22,16},{55,44,34,26},{80,64,48,36},{108,86,62,46},
+  {136,108,76,60},{156,124,88,66},{194,154,110,86},{232,182,132,100},{274,216,154,122},
+  {324,254,180,140},{370,290,206,158},{428,334,244,180},{461,365,261,197},{523,415,295,223},
+  {589,453,325,253},{647,507,367,283},{721,563,397,313},{795,627,445,341},{861,669,485,385},
+  {932,714,512,406},{1006,782,568,442},{1094,860,614,464},{1174,914,664,514},{1276,1000,718,538},
+  {1370,1062,754,596},{1468,1128,808,628},{1531,1193,871,661},{1631,1267,911,701},{1735,1373,985,745},
+  {1843,1455,1033,793},{1955,1541,1115,845},{2071,1631,1171,901},{2191,1725,1231,961},{2306,1812,1286,986},
+  {2434,1914,1354,1054},{2566,1992,1426,1096},{2702,2102,1502,1142},{2812,2216,1582,1222},{2956,2334,1666,1276},
+};
+
+// Max payload bytes of a single 8-bit segment (4-bit mode indicator plus an
+// 8/16-bit character count) at this version/ECL.
+inline int qr_byte_capacity(int version,int ecl){
+  if(version<=0) version=40;
+  if(version>40 || ecl<0 || ecl>3) throw std::runtime_error("bad QR version/ECL");
+  int bits=kDataCodewords[version][ecl]*8 - 4 - (version<10?8:16);
+  return bits/8;
+}
+
+// Chunk bytes that fit next to `overhead` bytes of per-code metadata.
+// base64=true for the JSON format, where the chunk is carried as base64 text.
+// Memoized per (version, ECL, overhead, encoding); safe to call from workers.
+inline int chunk_capacity(int version,int ecl,size_t overhead,bool base64){
+  static std::mutex m; static std::map<std::tuple<int,int,size_t,bool>,int> memo;
+  auto key=std::make_tuple(version,ecl,overhead,base64);
+  std::lock_guard<std::mutex> lk(m);
+  auto it=memo.find(key); if(it!=memo.end()) return it->second;
+  long room=(long)qr_byte_capacity(version,ecl)-(long)overhead;
+  int n = room<=0 ? 0 : base64 ? (int)(room/4*3) : (int)room;
+  memo.emplace(key,n);
+  return n;
+}
+
+} // namespace gzqr
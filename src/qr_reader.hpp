@@ -0,0 +1,148 @@
+#pragma once
+/*
+ * GitZipQR.cpp – PNG → QR payload
+ *
+ * Fast path for PNGs written by our own encoder: they are axis-aligned,
+ * noise-free and have an integer pixels-per-module scale. The grid geometry
+ * (margin, scale, version) is read off the top-left finder pattern, every
+ * module is sampled once at its centre, and the finder/timing patterns are
+ * checked. The module matrix is then re-rendered as a tiny clean image that
+ * ZXing reads in "pure" mode, which skips detection and runs only
+ * format/RS/bitstream decoding. If anything fails (photos, scans, foreign
+ * images) the full detector runs instead, with options tuned for real-world
+ * captures.
+ */
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <png.h>
+#include <ZXing/ReadBarcode.h>
+#include <ZXing/BarcodeFormat.h>
+#include <ZXing/ReaderOptions.h>
+
+namespace gzqr {
+
+// 8-bit pixels: channels==1 for grayscale PNGs, 4 (RGBA) for everything else.
+struct raster {
+  int w=0, h=0, channels=0; std::vector<uint8_t> px;
+  uint8_t lum(int x,int y)const{
+    const uint8_t* p=&px[((size_t)y*w+x)*channels];
+    return channels==1 ? p[0] : (uint8_t)((p[0]+p[1]+p[2])/3);
+  }
+  ZXing::ImageView view()const{ return ZXing::ImageView(px.data(),w,h,channels==1?ZXing::ImageFormat::Lum:ZXing::ImageFormat::RGBA); }
+};
+
+// ---------------- PNG reader ----------------
+// PNG bytes in memory (the library's input), read through png_set_read_fn.
+struct png_mem { const uint8_t* p; size_t n, off=0; };
+
+// From `fp`, or from `mem` when fp is null. Closes fp.
+inline raster png_read(FILE* fp,png_mem* mem){
+  png_structp png_ptr=png_create_read_struct(PNG_LIBPNG_VER_STRING,nullptr,nullptr,nullptr);
+  if(!png_ptr){ if(fp) fclose(fp); throw std::runtime_error("png_read_struct"); }
+  png_infop info_ptr=png_create_info_struct(png_ptr);
+  if(!info_ptr){ png_destroy_read_struct(&png_ptr,nullptr,nullptr); if(fp) fclose(fp); throw std::runtime_error("png_info_struct"); }
+  raster r; std::vector<png_bytep> rows;
+  if(setjmp(png_jmpbuf(png_ptr))){ png_destroy_read_struct(&png_ptr,&info_ptr,nullptr); if(fp) fclose(fp); throw std::runtime_error("png read"); }
+  if(fp) png_init_io(png_ptr, fp);
+  else png_set_read_fn(png_ptr,mem,[](png_structp p,png_bytep d,png_size_t n){
+    auto* m=(png_mem*)png_get_io_ptr(p);
+    if(n>m->n-m->off) png_error(p,"truncated");
+    std::memcpy(d,m->p+m->off,n); m->off+=n; });
+  png_read_info(png_ptr, info_ptr);
+  r.w=png_get_image_width(png_ptr,info_ptr); r.h=png_get_image_height(png_ptr,info_ptr);
+  png_byte ct=png_get_color_type(png_ptr,info_ptr), bd=png_get_bit_depth(png_ptr,info_ptr);
+  bool gray=(ct==PNG_COLOR_TYPE_GRAY) && !png_get_valid(png_ptr,info_ptr,PNG_INFO_tRNS);
+  if(bd==16) png_set_strip_16(png_ptr);
+  if(ct==PNG_COLOR_TYPE_GRAY && bd<8) png_set_expand_gray_1_2_4_to_8(png_ptr);
+  if(!gray){
+    if(ct==PNG_COLOR_TYPE_PALETTE) png_set_palette_to_rgb(png_ptr);
+    if(png_get_valid(png_ptr,info_ptr,PNG_INFO_tRNS)) png_set_tRNS_to_alpha(png_ptr);
+    if(ct==PNG_COLOR_TYPE_RGB || ct==PNG_COLOR_TYPE_GRAY || ct==PNG_COLOR_TYPE_PALETTE) png_set_filler(png_ptr,0xFF,PNG_FILLER_AFTER);
+    if(ct==PNG_COLOR_TYPE_GRAY || ct==PNG_COLOR_TYPE_GRAY_ALPHA) png_set_gray_to_rgb(png_ptr);
+  }
+  png_read_update_info(png_ptr, info_ptr);
+  r.channels=gray?1:4;
+  r.px.resize((size_t)r.w*r.h*r.channels); rows.resize(r.h);
+  for(int y=0;y<r.h;y++) rows[y]=r.px.data()+(size_t)y*r.w*r.channels;
+  png_read_image(png_ptr, rows.data());
+  png_destroy_read_struct(&png_ptr,&info_ptr,nullptr); if(fp) fclose(fp); return r;
+}
+inline raster png_read(const std::string& p){
+  FILE* fp=fopen(p.c_str(),"rb"); if(!fp) throw std::runtime_error("open png");
+  return png_read(fp,nullptr);
+}
+inline raster png_read(const uint8_t* p,size_t n){ png_mem m{p,n}; return png_read(nullptr,&m); }
+
+// ---------------- Fast path ----------------
+// Samples an axis-aligned, integer-scale code into mods (qsize², 1 = dark).
+// False unless the geometry is exact and finder + timing patterns check out.
+inline bool sample_pristine(const raster& r,std::vector<uint8_t>& mods,int& qsize){
+  if(r.w!=r.h || r.w<21) return false;
+  auto dark=[&](int x,int y){ return r.lum(x,y)<128; };
+  int o=0; while(o<r.w && !dark(o,o)) o++;              // quiet zone, in pixels
+  int run=0; while(o+run<r.w && dark(o+run,o)) run++;  // finder top edge = 7 modules
+  if(run==0 || run%7) return false;
+  int s=run/7; if(o%s) return false;
+  int span=r.w-2*o; if(span<=0 || span%s) return false;
+  qsize=span/s; if(qsize<21 || qsize>177 || (qsize-17)%4) return false;
+
+  mods.assign((size_t)qsize*qsize,0);
+  for(int my=0;my<qsize;my++) for(int mx=0;mx<qsize;mx++)
+    mods[(size_t)my*qsize+mx]=dark(o+mx*s+s/2,o+my*s+s/2);
+  auto at=[&](int x,int y){ return mods[(size_t)y*qsize+x]!=0; };
+
+  const int fx[3]={0,qsize-7,0}, fy[3]={0,0,qsize-7};
+  for(int f=0;f<3;f++) for(int j=0;j<7;j++) for(int i=0;i<7;i++){
+    int d=std::max(std::abs(i-3),std::abs(j-3));
+    if(at(fx[f]+i,fy[f]+j)!=(d!=2)) return false;
+  }
+  for(int k=8;k<qsize-8;k++) if(at(k,6)!=(k%2==0) || at(6,k)!=(k%2==0)) return false;
+  return true;
+}
+
+// Re-renders a module matrix as a small clean Lum image (2 px/module, 4-module
+// quiet zone) and decodes it with detection disabled.
+inline bool decode_modules(const std::vector<uint8_t>& mods,int qsize,std::string& out){
+  const int S=2, Q=4, W=(qsize+2*Q)*S;
+  std::vector<uint8_t> img((size_t)W*W,0xFF);
+  for(int my=0;my<qsize;my++) for(int mx=0;mx<qsize;mx++) if(mods[(size_t)my*qsize+mx])
+    for(int dy=0;dy<S;dy++) for(int dx=0;dx<S;dx++) img[(size_t)((Q+my)*S+dy)*W+(Q+mx)*S+dx]=0;
+  ZXing::ReaderOptions opts;
+  opts.setFormats(ZXing::BarcodeFormat::QRCode).setIsPure(true).setTryHarder(false).setTryRotate(false)
+      .setBinarizer(ZXing::Binarizer::FixedThreshold);
+  auto res=ZXing::ReadBarcode(ZXing::ImageView(img.data(),W,W,ZXing::ImageFormat::Lum),opts);
+  if(!res.isValid()) return false;
+  const auto& b=res.bytes(); out.assign(b.begin(),b.end()); return true;
+}
+
+// ---------------- QR decode ----------------
+// Returns the raw byte-mode payload (binary chunks must not go through
+// ZXing's text/charset conversion), or "" if no code was found.
+inline std::string decode_qr(const raster& r){
+  std::string out; std::vector<uint8_t> mods; int qsize=0;
+  if(sample_pristine(r,mods,qsize) && decode_modules(mods,qsize,out)) return out;
+
+  // Fallback: our codes at an unexpected scale are still "pure"; anything
+  // else (photos, scans, rotated crops) needs the full detector.
+  auto iv=r.view();
+  ZXing::ReaderOptions pure;
+  pure.setFormats(ZXing::BarcodeFormat::QRCode).setIsPure(true).setTryHarder(false).setTryRotate(false);
+  auto res=ZXing::ReadBarcode(iv,pure);
+  if(!res.isValid()){
+    ZXing::ReaderOptions full;
+    full.setFormats(ZXing::BarcodeFormat::QRCode).setTryHarder(true).setTryRotate(true)
+        .setBinarizer(ZXing::Binarizer::LocalAverage);
+    res=ZXing::ReadBarcode(iv,full);
+  }
+  if(!res.isValid()) return "";
+  const auto& b=res.bytes(); return std::string(b.begin(),b.end());
+}
+inline std::string decode_qr(const std::string& path){ return decode_qr(png_read(path)); }
+
+} // namespace gzqr
@@ -0,0 +1,205 @@
+#pragma once
+/*
+ * GitZipQR.cpp – sheet mode (many codes per PNG)
+ *
+ * A sheet tiles cols×rows data codes in a grid below a small index code.
+ * The index is a v2 chunk of kind 'S' that records which chunks the sheet
+ * holds and where the grid lies in pixels. Every cell keeps a quiet zone of
+ * at least 4 modules, so detectors can tell neighbours apart.
+ *
+ * The decoder pulls every code off a page with one ZXing::ReadBarcodes
+ * pass. If that finds fewer codes than the index promises, it crops each
+ * grid cell by the recorded geometry and decodes it on its own, which takes
+ * the pristine fast path for pages we wrote.
+ *
+ *   "a4"  → 3×4 codes at 4 px/module on a 2480×3508 page (A4 at 300 dpi)
+ *   "NxM" → N columns × M rows at the configured scale, page sized to fit
+ */
+#include "chunk_format.hpp"
+#include "png_writer.hpp"
+#include "qr_reader.hpp"
+#include "qr_capacity.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <qrencode.h>
+
+namespace gzqr {
+
+struct sheet_layout {
+  int cols=0, rows=0, scale=0, quiet=4;
+  int pageW=0, pageH=0;          // 0 = just large enough
+  int cells()const{ return cols*rows; }
+};
+
+inline bool parse_sheet(const std::string& s,int defaultScale,sheet_layout& L){
+  if(s=="a4"){ L=sheet_layout{3,4,4,4,2480,3508}; return true; }
+  int c=0,r=0; char x=0;
+  if(std::sscanf(s.c_str(),"%d%c%d",&c,&x,&r)!=3 || (x!='x'&&x!='X') || c<1 || r<1 || c>255 || r>255 || c*r>4096) return false;
+  L=sheet_layout{}; L.cols=c; L.rows=r; L.scale=defaultScale; return true;
+}
+
+// ---------------- Index code ----------------
+// Body: first chunk u32, count u16, cols u8, rows u8, cell px u16, grid x u16, grid y u16, page w u16, page h u16.
+struct sheet_index {
+  uint32_t sheet=0, first=0; uint16_t count=0; uint8_t cols=0, rows=0;
+  uint16_t cellPx=0, gridX=0, gridY=0, pageW=0, pageH=0;
+
+  std::vector<uint8_t> payload()const{
+    std::vector<uint8_t> b;
+    chunkfmt::put_u32(b,first); chunkfmt::put_u16(b,count); b.push_back(cols); b.push_back(rows);
+    chunkfmt::put_u16(b,cellPx); chunkfmt::put_u16(b,gridX); chunkfmt::put_u16(b,gridY);
+    chunkfmt::put_u16(b,pageW); chunkfmt::put_u16(b,pageH);
+    chunkfmt::header h; h.kind=chunkfmt::kSheet; h.index=sheet;
+    return chunkfmt::build(h,b.data(),b.size());
+  }
+  static bool parse(const std::string& raw,sheet_index& out){
+    chunkfmt::chunk_view cv;
+    if(!chunkfmt::parse((const uint8_t*)raw.data(),raw.size(),cv) || cv.h.kind!=chunkfmt::kSheet || cv.size<18) return false;
+    const uint8_t* p=cv.body;
+    out.sheet=cv.h.index; out.first=chunkfmt::get_u32(p); out.count=chunkfmt::get_u16(p+4); out.cols=p[6]; out.rows=p[7];
+    out.cellPx=chunkfmt::get_u16(p+8); out.gridX=chunkfmt::get_u16(p+10); out.gridY=chunkfmt::get_u16(p+12);
+    out.pageW=chunkfmt::get_u16(p+14); out.pageH=chunkfmt::get_u16(p+16);
+    return true;
+  }
+};
+
+// ---------------- Writer ----------------
+// Collects encoded codes from any worker; a sheet is written by the worker
+// that fills its last cell, and finish() writes the partial last one.
+class sheet_writer {
+public:
+  // Sheets are written as <prefix>-%05d.png.
+  sheet_writer(sheet_layout L,int qsize,std::string outdir,png_opts o,std::string prefix="qr-sheet")
+  :L_(L),qsize_(qsize),outdir_(std::move(outdir)),prefix_(std::move(prefix)),o_(o){
+    cell_=(qsize_+2*L_.quiet)*L_.scale;
+  }
+  ~sheet_writer(){ for(auto& [k,p]:pending_) for(auto* q:p.codes) QRcode_free(q); }
+
+  // Takes ownership of q.
+  void place(int chunk,QRcode* q){
+    if(q->width!=qsize_){ QRcode_free(q); throw std::runtime_error("sheet cell size mismatch"); }
+    int s=chunk/L_.cells(), k=chunk%L_.cells();
+    std::vector<QRcode*> full;
+    {
+      std::lock_guard<std::mutex> lk(m_);
+      auto& p=pending_[s]; if(p.codes.empty()) p.codes.assign(L_.cells(),nullptr);
+      p.codes[k]=q; p.filled++;
+      if(p.filled<L_.cells()) return;
+      full.swap(p.codes); pending_.erase(s);
+    }
+    write(s,full);
+  }
+  // Writes whatever is left (the last, partly filled sheet).
+  void finish(){
+    std::map<int,pending> left; { std::lock_guard<std::mutex> lk(m_); left.swap(pending_); }
+    for(auto& [s,p]:left) write(s,p.codes);
+  }
+  int sheets()const{ return written_; }
+
+private:
+  struct pending { std::vector<QRcode*> codes; int filled=0; };
+
+  void write(int s,std::vector<QRcode*>& codes){
+    struct guard { std::vector<QRcode*>& v; ~guard(){ for(auto* q:v) QRcode_free(q); v.clear(); } } g{codes};
+    int count=0; while(count<(int)codes.size() && codes[count]) count++;
+    const int S=L_.scale, Q=L_.quiet;
+
+    sheet_index ix; ix.sheet=(uint32_t)s; ix.first=(uint32_t)s*L_.cells(); ix.count=(uint16_t)count;
+    ix.cols=(uint8_t)L_.cols; ix.rows=(uint8_t)L_.rows; ix.cellPx=(uint16_t)cell_;
+    // The index payload has a fixed length, so its code size is known before
+    // the geometry it records.
+    const size_t hlen=ix.payload().size();
+    int hv=1; while(qr_byte_capacity(hv,QR_ECLEVEL_M)<(int)hlen) hv++;
+    const int band=(17+4*hv+2*Q)*S, gridW=L_.cols*cell_, gridH=L_.rows*cell_;
+    const int W=L_.pageW?L_.pageW:std::max(gridW,band), H=L_.pageH?L_.pageH:band+gridH;
+    if(gridW>W || band+gridH>H) throw std::runtime_error("sheet grid does not fit the page");
+    if(W>0xFFFF || H>0xFFFF) throw std::runtime_error("sheet larger than 65535 px; use a smaller grid");
+    const int gx=((W-gridW)/2)/S*S, gy=(band+(H-band-gridH)/2)/S*S;
+    ix.gridX=(uint16_t)gx; ix.gridY=(uint16_t)gy; ix.pageW=(uint16_t)W; ix.pageH=(uint16_t)H;
+    auto hdr=ix.payload();
+    QRcode* hq=QRcode_encodeData((int)hdr.size(),hdr.data(),hv,QR_ECLEVEL_M);
+    if(!hq) throw std::runtime_error("sheet index encode");
+
+    const size_t stride=png_stride(W,o_); const bool gray1=o_.mode==kPngGray1;
+    std::vector<uint8_t> blank(stride,0xFF), line(stride);
+    int built=-1;
+    auto row=[&](int y)->const uint8_t*{
+      int key=y/S;
+      if(key!=built){
+        built=key; std::memcpy(line.data(),blank.data(),stride);
+        int hm=y/S-Q;                                       // index code, top-left of the band
+        if(y<band && hm>=0 && hm<hq->width) paint_module_row(line.data(),hq->data+(size_t)hm*hq->width,hq->width,(size_t)Q*S,S,gray1);
+        if(y>=gy && y<gy+gridH){
+          int r=(y-gy)/cell_, my=((y-gy)%cell_)/S-Q;
+          if(my>=0 && my<qsize_) for(int c=0;c<L_.cols;c++){
+            int k=r*L_.cols+c; if(k>=count) break;
+            paint_module_row(line.data(),codes[k]->data+(size_t)my*qsize_,qsize_,(size_t)gx+(size_t)c*cell_+(size_t)Q*S,S,gray1);
+          }
+        }
+      }
+      return line.data();
+    };
+    char fn[32]; std::snprintf(fn,sizeof(fn),"-%05d.png",s);
+    try{ write_png_lines((std::filesystem::path(outdir_)/(prefix_+fn)).string(),W,H,row,o_); }catch(...){ QRcode_free(hq); throw; }
+    QRcode_free(hq);
+    std::lock_guard<std::mutex> lk(m_); written_++;
+  }
+
+  sheet_layout L_; int qsize_, cell_=0; std::string outdir_, prefix_; png_opts o_;
+  std::mutex m_; std::map<int,pending> pending_; int written_=0;
+};
+
+// ---------------- Reader ----------------
+inline raster crop(const raster& r,int x0,int y0,int w,int h){
+  raster c; c.w=w; c.h=h; c.channels=r.channels; c.px.resize((size_t)w*h*r.channels);
+  for(int y=0;y<h;y++) std::memcpy(&c.px[(size_t)y*w*r.channels],&r.px[((size_t)(y0+y)*r.w+x0)*r.channels],(size_t)w*r.channels);
+  return c;
+}
+
+// Every code payload in an image. A lone code of ours is handled by the
+// fast path; everything else goes through multi-symbol detection.
+inline std::vector<std::string> read_codes(const raster& r){
+  { std::vector<uint8_t> mods; int qsize=0; std::string one;
+    if(sample_pristine(r,mods,qsize) && decode_modules(mods,qsize,one)) return {one}; }
+
+  std::vector<std::string> out;
+  auto collect=[&](const ZXing::Results& rs){
+    for(const auto& res:rs) if(res.isValid()){
+      std::string b(res.bytes().begin(),res.bytes().end());
+      if(std::find(out.begin(),out.end(),b)==out.end()) out.push_back(std::move(b));
+    }
+  };
+  auto expected=[&](sheet_index& ix)->bool{ for(const auto& b:out) if(sheet_index::parse(b,ix)) return true; return false; };
+
+  ZXing::ReaderOptions fast;
+  fast.setFormats(ZXing::BarcodeFormat::QRCode).setTryHarder(false).setTryRotate(false).setBinarizer(ZXing::Binarizer::FixedThreshold);
+  collect(ZXing::ReadBarcodes(r.view(),fast));
+  sheet_index ix; bool sheet=expected(ix);
+  if(sheet && (int)out.size()>ix.count) return out;
+
+  // Our page at its original size: crop the cells the index describes.
+  if(sheet && ix.pageW==r.w && ix.pageH==r.h){
+    for(int k=0;k<ix.count;k++){
+      int x=ix.gridX+(k%ix.cols)*ix.cellPx, y=ix.gridY+(k/ix.cols)*ix.cellPx;
+      if(x+ix.cellPx>r.w || y+ix.cellPx>r.h) break;
+      std::string b=decode_qr(crop(r,x,y,ix.cellPx,ix.cellPx));
+      if(!b.empty() && std::find(out.begin(),out.end(),b)==out.end()) out.push_back(std::move(b));
+    }
+    if((int)out.size()>ix.count) return out;
+  }
+  // Photos, scans and foreign images: the full detector.
+  ZXing::ReaderOptions full;
+  full.setFormats(ZXing::BarcodeFormat::QRCode).setTryHarder(true).setTryRotate(true).setBinarizer(ZXing::Binarizer::LocalAverage);
+  collect(ZXing::ReadBarcodes(r.view(),full));
+  if(out.empty()){ std::string b=decode_qr(r); if(!b.empty()) out.push_back(std::move(b)); }
+  return out;
+}
+
+} // namespace gzqr
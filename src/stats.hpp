@@ -0,0 +1,148 @@
+#pragma once
+/*
+ * GitZipQR.cpp – stage statistics (--stats, --stats-json)
+ *
+ * A stat_scope charges the time it is open to one stage: wall clock and
+ * thread CPU time, plus bytes and an item count. Scopes nest per thread and
+ * an inner scope pauses the outer one, so in a sink chain (input → compress →
+ * encrypt → chunker) every stage gets only its own time. Per-item stages
+ * (one QR encode, one PNG read, ...) also keep their latency so p50/p99 can
+ * be reported. When stats are off a scope is a single bool test.
+ *
+ * Wall and CPU times are summed over all threads. With N workers a stage can
+ * show up to N× the elapsed time, and MB/s is per thread.
+ */
+#include "stream.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <sys/resource.h>
+
+namespace gzqr {
+
+enum stage : int {
+  stKdf, stInput, stCompress, stEncrypt, stChunker, stParity, stChunkBuild, stQrEncode, stPngWrite,
+  stPngRead, stQrDecode, stJsonParse, stDecrypt, stDecompress, stOutput, stCount
+};
+inline const char* stage_name(int s){
+  static const char* n[stCount]={"kdf","input","compress","encrypt","chunker","parity","chunk_build","qr_encode","png_write",
+                                 "png_read","qr_decode","json_parse","decrypt","decompress","output"};
+  return n[s];
+}
+
+class stats_registry {
+public:
+  struct totals { uint64_t wallNs=0, cpuNs=0, bytes=0, items=0; std::vector<uint64_t> lat; };
+
+  void enable(){ enabled_=true; t0_=std::chrono::steady_clock::now(); }
+  bool on()const{ return enabled_; }
+
+  void add(int s,uint64_t wallNs,uint64_t cpuNs,uint64_t bytes,uint64_t items,uint64_t latNs,bool sample){
+    auto& x=st_[s];
+    x.wallNs+=wallNs; x.cpuNs+=cpuNs; x.bytes+=bytes; x.items+=items;
+    if(sample){ std::lock_guard<std::mutex> lk(x.m); x.lat.push_back(latNs); }
+  }
+  totals get(int s){
+    auto& x=st_[s]; totals t{x.wallNs.load(),x.cpuNs.load(),x.bytes.load(),x.items.load(),{}};
+    std::lock_guard<std::mutex> lk(x.m); t.lat=x.lat; return t;
+  }
+  double elapsed()const{ return std::chrono::duration<double>(std::chrono::steady_clock::now()-t0_).count(); }
+
+  // Human-readable table of the stages that saw any activity. Stream stages
+  // (sink chain, stat_sink) have no items and show "-".
+  void print(FILE* f){
+    std::fprintf(f,"\n── stats (%.2fs elapsed, %.2fs cpu) ──\n%-12s %9s %9s %8s %9s %8s %8s %8s\n",
+                 elapsed(),process_cpu(),"stage","wall s","cpu s","items","MB","MB/s","p50 ms","p99 ms");
+    for(int s=0;s<stCount;s++){
+      auto t=get(s); if(!t.items && !t.wallNs) continue;
+      double w=t.wallNs/1e9, mb=t.bytes/1e6;
+      char items[24]; if(t.items) std::snprintf(items,sizeof(items),"%llu",(unsigned long long)t.items); else std::snprintf(items,sizeof(items),"-");
+      std::fprintf(f,"%-12s %9.3f %9.3f %8s %9.2f %8.1f %8.2f %8.2f\n",stage_name(s),w,t.cpuNs/1e9,
+                   items,mb,w>0?mb/w:0.0,pct(t.lat,50)/1e6,pct(t.lat,99)/1e6);
+    }
+  }
+  // Same numbers as JSON (seconds, bytes, milliseconds) for scripts.
+  void write_json(const std::string& path,const std::string& tool){
+    std::string j; char b[512];
+    std::snprintf(b,sizeof(b),"{\"tool\":\"%s\",\"elapsedSec\":%.6f,\"cpuSec\":%.6f,\"stages\":{",tool.c_str(),elapsed(),process_cpu()); j+=b;
+    bool first=true;
+    for(int s=0;s<stCount;s++){
+      auto t=get(s); if(!t.items && !t.wallNs) continue;
+      std::snprintf(b,sizeof(b),"%s\"%s\":{\"wallSec\":%.6f,\"cpuSec\":%.6f,\"bytes\":%llu,\"items\":%llu",first?"":",",stage_name(s),
+                    t.wallNs/1e9,t.cpuNs/1e9,(unsigned long long)t.bytes,(unsigned long long)t.items); j+=b; first=false;
+      if(!t.lat.empty()){ std::snprintf(b,sizeof(b),",\"samples\":%zu,\"p50Ms\":%.4f,\"p99Ms\":%.4f",t.lat.size(),pct(t.lat,50)/1e6,pct(t.lat,99)/1e6); j+=b; }
+      j+='}';
+    }
+    j+="}}\n";
+    file_sink f(path); f.write((const uint8_t*)j.data(),j.size()); f.finish();
+  }
+
+  static uint64_t thread_cpu_ns(){ timespec ts{}; clock_gettime(CLOCK_THREAD_CPUTIME_ID,&ts); return (uint64_t)ts.tv_sec*1000000000ull+ts.tv_nsec; }
+  static uint64_t wall_ns(){ return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count(); }
+
+private:
+  struct slot { std::atomic<uint64_t> wallNs{0}, cpuNs{0}, bytes{0}, items{0}; std::mutex m; std::vector<uint64_t> lat; };
+  static double pct(std::vector<uint64_t> v,int p){
+    if(v.empty()) return 0;
+    size_t k=std::min(v.size()-1,(v.size()*p)/100);
+    std::nth_element(v.begin(),v.begin()+k,v.end()); return (double)v[k];
+  }
+  static double process_cpu(){ rusage u{}; getrusage(RUSAGE_SELF,&u); return u.ru_utime.tv_sec+u.ru_stime.tv_sec+(u.ru_utime.tv_usec+u.ru_stime.tv_usec)/1e6; }
+
+  bool enabled_=false; std::chrono::steady_clock::time_point t0_;
+  slot st_[stCount];
+};
+
+inline stats_registry& stats(){ static stats_registry r; return r; }
+
+// Charges its lifetime to stage `s` (exclusive of nested scopes on the same
+// thread). `sample` records the inclusive latency for p50/p99.
+class stat_scope {
+public:
+  explicit stat_scope(int s,uint64_t bytes=0,bool sample=false,uint64_t items=1){
+    if(!stats().on()) return;
+    s_=s; bytes_=bytes; items_=items; sample_=sample;
+    parent_=top(); if(parent_) parent_->pause();
+    top()=this; begin_=stats_registry::wall_ns(); resume();
+  }
+  ~stat_scope(){ stop(); }
+  // Ends the scope early; the destructor then does nothing.
+  void stop(){
+    if(s_<0) return;
+    pause(); top()=parent_;
+    stats().add(s_,wall_,cpu_,bytes_,items_,stats_registry::wall_ns()-begin_,sample_);
+    if(parent_) parent_->resume();
+    s_=-1;
+  }
+  void add_bytes(uint64_t n){ bytes_+=n; }
+  stat_scope(const stat_scope&)=delete; stat_scope& operator=(const stat_scope&)=delete;
+private:
+  static stat_scope*& top(){ thread_local stat_scope* t=nullptr; return t; }
+  void pause(){ wall_+=stats_registry::wall_ns()-w0_; cpu_+=stats_registry::thread_cpu_ns()-c0_; }
+  void resume(){ w0_=stats_registry::wall_ns(); c0_=stats_registry::thread_cpu_ns(); }
+  int s_=-1; bool sample_=false; stat_scope* parent_=nullptr;
+  uint64_t bytes_=0, items_=1, begin_=0, w0_=0, c0_=0, wall_=0, cpu_=0;
+};
+
+// Puts a sink chain stage under a stat_scope: every write is charged to `s`
+// (minus the time spent further down the chain) with its byte count. Writes
+// are arbitrary slices of a stream, so they add no items.
+class stat_sink : public byte_sink {
+public:
+  stat_sink(int s,byte_sink& next):s_(s),next_(next){}
+  void write(const uint8_t* p,size_t n)override{
+    if(!stats().on()){ next_.write(p,n); return; }
+    stat_scope sc(s_,n,false,0); next_.write(p,n);
+  }
+  void finish()override{ stat_scope sc(s_,0,false,0); next_.finish(); }
+private: int s_; byte_sink& next_;
+};
+
+} // namespace gzqr
@@ -0,0 +1,163 @@
+#pragma once
+/*
+ * GitZipQR.cpp – streaming stages
+ *
+ * The encoder is a chain of byte_sinks: source (file / directory archiver)
+ * → compressor → AES-256-GCM → chunker → QR workers. Every stage only holds
+ * one block, so an encode is a single pass over the input with bounded
+ * memory and no temporary files.
+ */
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <openssl/evp.h>
+
+namespace gzqr {
+
+struct byte_sink {
+  virtual ~byte_sink()=default;
+  virtual void write(const uint8_t* p,size_t n)=0;
+  virtual void finish(){}
+};
+
+// Feeds a whole file into a sink in 1 MiB blocks.
+inline void stream_file(const std::string& path,byte_sink& out){
+  FILE* f=fopen(path.c_str(),"rb"); if(!f) throw std::runtime_error("open input");
+  std::vector<uint8_t> b(1<<20); size_t n;
+  try{ while((n=fread(b.data(),1,b.size(),f))>0) out.write(b.data(),n); }catch(...){ fclose(f); throw; }
+  fclose(f);
+}
+
+struct file_sink : byte_sink {
+  explicit file_sink(const std::string& path):f_(fopen(path.c_str(),"wb")){ if(!f_) throw std::runtime_error("open out"); }
+  ~file_sink(){ if(f_) fclose(f_); }
+  void write(const uint8_t* p,size_t n)override{ if(n && fwrite(p,1,n,f_)!=n) throw std::runtime_error("write"); }
+  void finish()override{ if(f_){ int r=fclose(f_); f_=nullptr; if(r) throw std::runtime_error("write"); } }
+private: FILE* f_;
+};
+
+// Hands every block to a callback (the library's in-memory output).
+struct callback_sink : byte_sink {
+  explicit callback_sink(std::function<void(const uint8_t*,size_t)> f):f_(std::move(f)){}
+  void write(const uint8_t* p,size_t n)override{ if(n) f_(p,n); }
+private: std::function<void(const uint8_t*,size_t)> f_;
+};
+
+// Collects everything in memory (sealed blocks, recipes, index records).
+struct vector_sink : byte_sink {
+  std::vector<uint8_t> data;
+  void write(const uint8_t* p,size_t n)override{ data.insert(data.end(),p,p+n); }
+};
+
+// Incremental SHA-256 (EVP, so no deprecated SHA256_* calls).
+class sha256_stream {
+public:
+  sha256_stream():c_(EVP_MD_CTX_new()){ if(!c_ || 1!=EVP_DigestInit_ex(c_,EVP_sha256(),nullptr)) throw std::runtime_error("sha256 init"); }
+  ~sha256_stream(){ EVP_MD_CTX_free(c_); }
+  sha256_stream(const sha256_stream&)=delete; sha256_stream& operator=(const sha256_stream&)=delete;
+  void update(const uint8_t* p,size_t n){ if(n && 1!=EVP_DigestUpdate(c_,p,n)) throw std::runtime_error("sha256 update"); }
+  std::vector<uint8_t> final(){ std::vector<uint8_t> d(32); unsigned int l=0; EVP_DigestFinal_ex(c_,d.data(),&l); return d; }
+private: EVP_MD_CTX* c_;
+};
+
+// AES-256-GCM: plaintext in, ciphertext out, 16-byte tag appended on finish().
+// Same wire layout as aes_gcm_encrypt_file().
+class gcm_encrypt_sink : public byte_sink {
+public:
+  gcm_encrypt_sink(const std::vector<uint8_t>& key,const std::vector<uint8_t>& nonce,const std::vector<uint8_t>& aad,byte_sink& next)
+  :next_(next),ctx_(EVP_CIPHER_CTX_new()),buf_((1<<20)+16){
+    if(!ctx_) throw std::runtime_error("ctx");
+    if(1!=EVP_EncryptInit_ex(ctx_,EVP_aes_256_gcm(),nullptr,nullptr,nullptr)) throw std::runtime_error("init");
+    if(1!=EVP_CIPHER_CTX_ctrl(ctx_,EVP_CTRL_GCM_SET_IVLEN,nonce.size(),nullptr)) throw std::runtime_error("ivlen");
+    if(1!=EVP_EncryptInit_ex(ctx_,nullptr,nullptr,key.data(),nonce.data())) throw std::runtime_error("keyiv");
+    int outl=0; if(!aad.empty() && 1!=EVP_EncryptUpdate(ctx_,nullptr,&outl,aad.data(),aad.size())) throw std::runtime_error("aad");
+  }
+  ~gcm_encrypt_sink(){ EVP_CIPHER_CTX_free(ctx_); }
+  void write(const uint8_t* p,size_t n)override{
+    while(n>0){
+      int step=(int)std::min<size_t>(n,1<<20), outl=0;
+      if(1!=EVP_EncryptUpdate(ctx_,buf_.data(),&outl,p,step)) throw std::runtime_error("upd");
+      if(outl>0) next_.write(buf_.data(),outl);
+      p+=step; n-=step;
+    }
+  }
+  void finish()override{
+    int outl=0; if(1!=EVP_EncryptFinal_ex(ctx_,buf_.data(),&outl)) throw std::runtime_error("final");
+    if(outl>0) next_.write(buf_.data(),outl);
+    unsigned char tag[16]; if(1!=EVP_CIPHER_CTX_ctrl(ctx_,EVP_CTRL_GCM_GET_TAG,16,tag)) throw std::runtime_error("tag");
+    next_.write(tag,16); next_.finish();
+  }
+private: byte_sink& next_; EVP_CIPHER_CTX* ctx_; std::vector<uint8_t> buf_;
+};
+
+// Inverse of gcm_encrypt_sink: ciphertext+tag in, plaintext out. The last 16
+// bytes seen are held back as the tag; finish() throws if it doesn't verify,
+// so downstream output must be discarded on error.
+class gcm_decrypt_sink : public byte_sink {
+public:
+  gcm_decrypt_sink(const std::vector<uint8_t>& key,const std::vector<uint8_t>& nonce,const std::vector<uint8_t>& aad,byte_sink& next)
+  :next_(next),ctx_(EVP_CIPHER_CTX_new()),buf_((1<<20)+16){
+    if(!ctx_) throw std::runtime_error("ctx");
+    if(1!=EVP_DecryptInit_ex(ctx_,EVP_aes_256_gcm(),nullptr,nullptr,nullptr)) throw std::runtime_error("dec init");
+    if(1!=EVP_CIPHER_CTX_ctrl(ctx_,EVP_CTRL_GCM_SET_IVLEN,nonce.size(),nullptr)) throw std::runtime_error("ivlen");
+    if(1!=EVP_DecryptInit_ex(ctx_,nullptr,nullptr,key.data(),nonce.data())) throw std::runtime_error("keyiv");
+    int outl=0; if(!aad.empty() && 1!=EVP_DecryptUpdate(ctx_,nullptr,&outl,aad.data(),aad.size())) throw std::runtime_error("aad");
+  }
+  ~gcm_decrypt_sink(){ EVP_CIPHER_CTX_free(ctx_); }
+  void write(const uint8_t* p,size_t n)override{
+    // Whatever is beyond the last 16 bytes of (tail_ + p) is ciphertext.
+    size_t avail=tail_.size()+n;
+    if(avail<=16){ tail_.insert(tail_.end(),p,p+n); return; }
+    size_t ready=avail-16, fromTail=std::min(ready,tail_.size());
+    update(tail_.data(),fromTail); tail_.erase(tail_.begin(),tail_.begin()+fromTail);
+    size_t fromP=ready-fromTail; update(p,fromP);
+    tail_.insert(tail_.end(),p+fromP,p+n);
+  }
+  void finish()override{
+    if(tail_.size()!=16) throw std::runtime_error("cipher too short");
+    if(1!=EVP_CIPHER_CTX_ctrl(ctx_,EVP_CTRL_GCM_SET_TAG,16,tail_.data())) throw std::runtime_error("tag");
+    int outl=0; if(1!=EVP_DecryptFinal_ex(ctx_,buf_.data(),&outl)) throw std::runtime_error("GCM auth failed");
+    if(outl>0) next_.write(buf_.data(),outl);
+    next_.finish();
+  }
+private:
+  void update(const uint8_t* p,size_t n){
+    while(n>0){
+      int step=(int)std::min<size_t>(n,1<<20), outl=0;
+      if(1!=EVP_DecryptUpdate(ctx_,buf_.data(),&outl,p,step)) throw std::runtime_error("dec upd");
+      if(outl>0) next_.write(buf_.data(),outl);
+      p+=step; n-=step;
+    }
+  }
+  byte_sink& next_; EVP_CIPHER_CTX* ctx_; std::vector<uint8_t> buf_, tail_;
+};
+
+// Cuts the stream into fixed-size chunks (last one shorter) and hands each to
+// `emit` with its index. Also hashes everything that passes through.
+class chunk_sink : public byte_sink {
+public:
+  using emit_fn=std::function<void(int,std::vector<uint8_t>)>;
+  chunk_sink(size_t chunkSize,emit_fn emit):size_(chunkSize),emit_(std::move(emit)){ cur_.reserve(size_); }
+  void write(const uint8_t* p,size_t n)override{
+    sha_.update(p,n); bytes_+=n;
+    while(n>0){
+      size_t k=std::min(n,size_-cur_.size());
+      cur_.insert(cur_.end(),p,p+k); p+=k; n-=k;
+      if(cur_.size()==size_) flush();
+    }
+  }
+  void finish()override{ if(!cur_.empty()) flush(); digest_=sha_.final(); }
+  int count()const{ return next_; }
+  uint64_t bytes()const{ return bytes_; }
+  const std::vector<uint8_t>& digest()const{ return digest_; }
+private:
+  void flush(){ std::vector<uint8_t> c; c.reserve(size_); c.swap(cur_); emit_(next_++,std::move(c)); }
+  size_t size_; emit_fn emit_; std::vector<uint8_t> cur_, digest_;
+  sha256_stream sha_; uint64_t bytes_=0; int next_=0;
+};
+
+} // namespace gzqr
@@ -0,0 +1,226 @@
+#pragma once
+/*
+ * GitZipQR.cpp – base64 and hex kernels
+ *
+ * Every JSON code carries its chunk as base64, and hashes are printed as hex,
+ * so these run on every chunk in both tools. All kernels write into a
+ * caller-provided buffer (b64_size / b64_decoded_max give the sizes); the
+ * std::string wrappers in common.hpp size the result once.
+ *
+ * Base64 uses the pshufb formulation from Muła and Lemire: 12 (SSSE3) or 24
+ * (AVX2) input bytes are spread into 6-bit indices with multiplies and
+ * mapped to ASCII with one 16-entry offset table. Decoding validates a whole
+ * block with two nibble lookups; a block with anything but alphabet
+ * characters (padding, line breaks) goes through the scalar loop, which has
+ * the old b64d() semantics: unknown characters are skipped and '=' ends the
+ * input. Hex is two nibble lookups and an interleave. The kernel is picked at
+ * run time; the scalar one is always there.
+ */
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define GZQR_TEXT_X86 1
+#endif
+
+namespace gzqr::text {
+
+inline constexpr char kB64[]="ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+inline constexpr char kHex[]="0123456789abcdef";
+
+inline size_t b64_size(size_t n){ return (n+2)/3*4; }
+// Upper bound for b64_decode's output, including the SIMD tail store.
+inline size_t b64_decoded_max(size_t n){ return n/4*3+3; }
+
+// ---------------- Scalar ----------------
+inline size_t b64_encode_scalar(const uint8_t* in,size_t n,char* out){
+  char* o=out; size_t i=0;
+  for(;i+3<=n;i+=3){
+    uint32_t v=(in[i]<<16)|(in[i+1]<<8)|in[i+2];
+    o[0]=kB64[v>>18]; o[1]=kB64[(v>>12)&63]; o[2]=kB64[(v>>6)&63]; o[3]=kB64[v&63]; o+=4;
+  }
+  if(i+1==n){ uint32_t v=in[i]<<16; o[0]=kB64[v>>18]; o[1]=kB64[(v>>12)&63]; o[2]='='; o[3]='='; o+=4; }
+  else if(i+2==n){ uint32_t v=(in[i]<<16)|(in[i+1]<<8); o[0]=kB64[v>>18]; o[1]=kB64[(v>>12)&63]; o[2]=kB64[(v>>6)&63]; o[3]='='; o+=4; }
+  return (size_t)(o-out);
+}
+
+struct b64_table { int8_t v[256]; b64_table(){ for(auto& x:v) x=-1; for(int i=0;i<64;i++) v[(uint8_t)kB64[i]]=(int8_t)i; } };
+inline const int8_t* b64_rev(){ static const b64_table t; return t.v; }
+
+// Decode state between kernels: bits not yet written. `done` once '=' is seen.
+struct b64_state { uint32_t val=0; int bits=0; bool done=false; };
+// Scalar steps over in[0..n); stops early (returns chars used) once `stopAligned`
+// and a whole quantum has been consumed, so a block kernel can take over.
+inline size_t b64_decode_step(const char* in,size_t n,uint8_t*& out,b64_state& s,bool stopAligned){
+  const int8_t* T=b64_rev(); size_t i=0;
+  while(i<n){
+    uint8_t c=(uint8_t)in[i++]; int8_t d=T[c];
+    if(d<0){ if(c=='='){ s.done=true; return i; } continue; }
+    s.val=(s.val<<6)|(uint32_t)d; s.bits+=6;
+    if(s.bits>=8){ s.bits-=8; *out++=(uint8_t)(s.val>>s.bits); s.val&=(1u<<s.bits)-1; }
+    if(stopAligned && s.bits==0) return i;
+  }
+  return i;
+}
+inline size_t b64_decode_scalar(const char* in,size_t n,uint8_t* out){
+  uint8_t* o=out; b64_state s; b64_decode_step(in,n,o,s,false); return (size_t)(o-out);
+}
+
+inline void hex_encode_scalar(const uint8_t* in,size_t n,char* out){
+  for(size_t i=0;i<n;i++){ out[2*i]=kHex[in[i]>>4]; out[2*i+1]=kHex[in[i]&15]; }
+}
+
+#ifdef GZQR_TEXT_X86
+// ---------------- SSSE3 ----------------
+// 6-bit indices (one per byte) → ASCII.
+__attribute__((target("ssse3"))) inline __m128i b64_ascii_128(__m128i idx){
+  const __m128i shift=_mm_setr_epi8('a'-26,'0'-52,'0'-52,'0'-52,'0'-52,'0'-52,'0'-52,'0'-52,'0'-52,'0'-52,'0'-52,'+'-62,'/'-63,'A',0,0);
+  __m128i r=_mm_subs_epu8(idx,_mm_set1_epi8(51));
+  r=_mm_or_si128(r,_mm_and_si128(_mm_cmpgt_epi8(_mm_set1_epi8(26),idx),_mm_set1_epi8(13)));
+  return _mm_add_epi8(_mm_shuffle_epi8(shift,r),idx);
+}
+// 12 bytes (in a 16-byte register) → 16 indices.
+__attribute__((target("ssse3"))) inline __m128i b64_split_128(__m128i x){
+  x=_mm_shuffle_epi8(x,_mm_setr_epi8(1,0,2,1,4,3,5,4,7,6,8,7,10,9,11,10));
+  __m128i a=_mm_mulhi_epu16(_mm_and_si128(x,_mm_set1_epi32(0x0fc0fc00)),_mm_set1_epi32(0x04000040));
+  __m128i b=_mm_mullo_epi16(_mm_and_si128(x,_mm_set1_epi32(0x003f03f0)),_mm_set1_epi32(0x01000010));
+  return _mm_or_si128(a,b);
+}
+__attribute__((target("ssse3"))) inline size_t b64_encode_ssse3(const uint8_t* in,size_t n,char* out){
+  size_t i=0; char* o=out;
+  for(;i+16<=n;i+=12,o+=16)   // reads 16, uses 12
+    _mm_storeu_si128((__m128i*)o,b64_ascii_128(b64_split_128(_mm_loadu_si128((const __m128i*)(in+i)))));
+  return (size_t)(o-out)+b64_encode_scalar(in+i,n-i,o);
+}
+
+// 16 chars → 12 bytes at out (16 stored). False if any char is not in the alphabet.
+__attribute__((target("ssse3"))) inline bool b64_block_128(const char* in,uint8_t* out){
+  const __m128i lutLo=_mm_setr_epi8(0x15,0x11,0x11,0x11,0x11,0x11,0x11,0x11,0x11,0x11,0x13,0x1A,0x1B,0x1B,0x1B,0x1A);
+  const __m128i lutHi=_mm_setr_epi8(0x10,0x10,0x01,0x02,0x04,0x08,0x04,0x08,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x10);
+  const __m128i lutRoll=_mm_setr_epi8(0,16,19,4,-65,-65,-71,-71,0,0,0,0,0,0,0,0), m=_mm_set1_epi8(0x0f);
+  __m128i x=_mm_loadu_si128((const __m128i*)in);
+  __m128i hi=_mm_and_si128(_mm_srli_epi32(x,4),m), lo=_mm_and_si128(x,m);
+  __m128i bad=_mm_and_si128(_mm_shuffle_epi8(lutLo,lo),_mm_shuffle_epi8(lutHi,hi));
+  if(_mm_movemask_epi8(_mm_cmpeq_epi8(bad,_mm_setzero_si128()))!=0xFFFF) return false;
+  __m128i roll=_mm_shuffle_epi8(lutRoll,_mm_add_epi8(_mm_cmpeq_epi8(x,_mm_set1_epi8('/')),hi));
+  x=_mm_add_epi8(x,roll);
+  x=_mm_maddubs_epi16(x,_mm_set1_epi32(0x01400140));
+  x=_mm_madd_epi16(x,_mm_set1_epi32(0x00011000));
+  x=_mm_shuffle_epi8(x,_mm_setr_epi8(2,1,0,6,5,4,10,9,8,14,13,12,-1,-1,-1,-1));
+  _mm_storeu_si128((__m128i*)out,x);
+  return true;
+}
+
+__attribute__((target("ssse3"))) inline void hex_encode_ssse3(const uint8_t* in,size_t n,char* out){
+  const __m128i lut=_mm_loadu_si128((const __m128i*)kHex), m=_mm_set1_epi8(0x0f);
+  size_t i=0;
+  for(;i+16<=n;i+=16){
+    __m128i x=_mm_loadu_si128((const __m128i*)(in+i));
+    __m128i h=_mm_shuffle_epi8(lut,_mm_and_si128(_mm_srli_epi16(x,4),m)), l=_mm_shuffle_epi8(lut,_mm_and_si128(x,m));
+    _mm_storeu_si128((__m128i*)(out+2*i),_mm_unpacklo_epi8(h,l));
+    _mm_storeu_si128((__m128i*)(out+2*i+16),_mm_unpackhi_epi8(h,l));
+  }
+  hex_encode_scalar(in+i,n-i,out+2*i);
+}
+
+// ---------------- AVX2 ----------------
+__attribute__((target("avx2"))) inline size_t b64_encode_avx2(const uint8_t* in,size_t n,char* out){
+  const __m256i shuf=_mm256_setr_epi8(1,0,2,1,4,3,5,4,7,6,8,7,10,9,11,10, 1,0,2,1,4,3,5,4,7,6,8,7,10,9,11,10);
+  const __m256i shift=_mm256_setr_epi8('a'-26,'0'-52,'0'-52,'0'-52,'0'-52,'0'-52,'0'-52,'0'-52,'0'-52,'0'-52,'0'-52,'+'-62,'/'-63,'A',0,0,
+                                       'a'-26,'0'-52,'0'-52,'0'-52,'0'-52,'0'-52,'0'-52,'0'-52,'0'-52,'0'-52,'0'-52,'+'-62,'/'-63,'A',0,0);
+  size_t i=0; char* o=out;
+  for(;i+28<=n;i+=24,o+=32){   // two 16-byte loads, 12 bytes used from each
+    __m256i x=_mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)(in+i))),_mm_loadu_si128((const __m128i*)(in+i+12)),1);
+    x=_mm256_shuffle_epi8(x,shuf);
+    __m256i a=_mm256_mulhi_epu16(_mm256_and_si256(x,_mm256_set1_epi32(0x0fc0fc00)),_mm256_set1_epi32(0x04000040));
+    __m256i b=_mm256_mullo_epi16(_mm256_and_si256(x,_mm256_set1_epi32(0x003f03f0)),_mm256_set1_epi32(0x01000010));
+    __m256i idx=_mm256_or_si256(a,b);
+    __m256i r=_mm256_subs_epu8(idx,_mm256_set1_epi8(51));
+    r=_mm256_or_si256(r,_mm256_and_si256(_mm256_cmpgt_epi8(_mm256_set1_epi8(26),idx),_mm256_set1_epi8(13)));
+    _mm256_storeu_si256((__m256i*)o,_mm256_add_epi8(_mm256_shuffle_epi8(shift,r),idx));
+  }
+  return (size_t)(o-out)+b64_encode_ssse3(in+i,n-i,o);
+}
+
+// 32 chars → 24 bytes at out (32 stored).
+__attribute__((target("avx2"))) inline bool b64_block_256(const char* in,uint8_t* out){
+  const __m256i lutLo=_mm256_setr_epi8(0x15,0x11,0x11,0x11,0x11,0x11,0x11,0x11,0x11,0x11,0x13,0x1A,0x1B,0x1B,0x1B,0x1A,
+                                       0x15,0x11,0x11,0x11,0x11,0x11,0x11,0x11,0x11,0x11,0x13,0x1A,0x1B,0x1B,0x1B,0x1A);
+  const __m256i lutHi=_mm256_setr_epi8(0x10,0x10,0x01,0x02,0x04,0x08,0x04,0x08,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x10,
+                                       0x10,0x10,0x01,0x02,0x04,0x08,0x04,0x08,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x10);
+  const __m256i lutRoll=_mm256_setr_epi8(0,16,19,4,-65,-65,-71,-71,0,0,0,0,0,0,0,0, 0,16,19,4,-65,-65,-71,-71,0,0,0,0,0,0,0,0);
+  const __m256i m=_mm256_set1_epi8(0x0f);
+  __m256i x=_mm256_loadu_si256((const __m256i*)in);
+  __m256i hi=_mm256_and_si256(_mm256_srli_epi32(x,4),m), lo=_mm256_and_si256(x,m);
+  if(!_mm256_testz_si256(_mm256_shuffle_epi8(lutLo,lo),_mm256_shuffle_epi8(lutHi,hi))) return false;
+  __m256i roll=_mm256_shuffle_epi8(lutRoll,_mm256_add_epi8(_mm256_cmpeq_epi8(x,_mm256_set1_epi8('/')),hi));
+  x=_mm256_add_epi8(x,roll);
+  x=_mm256_maddubs_epi16(x,_mm256_set1_epi32(0x01400140));
+  x=_mm256_madd_epi16(x,_mm256_set1_epi32(0x00011000));
+  x=_mm256_shuffle_epi8(x,_mm256_setr_epi8(2,1,0,6,5,4,10,9,8,14,13,12,-1,-1,-1,-1, 2,1,0,6,5,4,10,9,8,14,13,12,-1,-1,-1,-1));
+  x=_mm256_permutevar8x32_epi32(x,_mm256_setr_epi32(0,1,2,4,5,6,7,7));
+  _mm256_storeu_si256((__m256i*)out,x);
+  return true;
+}
+
+__attribute__((target("avx2"))) inline void hex_encode_avx2(const uint8_t* in,size_t n,char* out){
+  const __m256i lut=_mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)kHex)), m=_mm256_set1_epi8(0x0f);
+  size_t i=0;
+  for(;i+32<=n;i+=32){
+    __m256i x=_mm256_loadu_si256((const __m256i*)(in+i));
+    __m256i h=_mm256_shuffle_epi8(lut,_mm256_and_si256(_mm256_srli_epi16(x,4),m)), l=_mm256_shuffle_epi8(lut,_mm256_and_si256(x,m));
+    __m256i a=_mm256_unpacklo_epi8(h,l), b=_mm256_unpackhi_epi8(h,l);   // per-lane interleave
+    _mm256_storeu_si256((__m256i*)(out+2*i),_mm256_permute2x128_si256(a,b,0x20));
+    _mm256_storeu_si256((__m256i*)(out+2*i+32),_mm256_permute2x128_si256(a,b,0x31));
+  }
+  hex_encode_ssse3(in+i,n-i,out+2*i);
+}
+#endif
+
+// Block loop shared by the SIMD decoders: whole blocks while they are clean
+// and enough input is left that the wide store stays inside
+// b64_decoded_max(n); the scalar step in between re-aligns to a quantum.
+template<size_t W,bool(*Block)(const char*,uint8_t*)>
+inline size_t b64_decode_blocks(const char* in,size_t n,uint8_t* out){
+  uint8_t* o=out; b64_state s; size_t i=0;
+  while(i<n && !s.done){
+    while(s.bits==0 && i+W+W/2<=n && Block(in+i,o)){ i+=W; o+=W/4*3; }
+    if(i>=n) break;
+    // At most one block of scalar, then try the wide path again.
+    size_t lim=std::min(n-i,W);
+    i+=b64_decode_step(in+i,lim,o,s,false);
+    if(!s.done && s.bits) i+=b64_decode_step(in+i,n-i,o,s,true);
+  }
+  return (size_t)(o-out);
+}
+
+// ---------------- Dispatch ----------------
+struct kernel {
+  const char* name;
+  size_t (*b64_encode)(const uint8_t*,size_t,char*);
+  size_t (*b64_decode)(const char*,size_t,uint8_t*);
+  void (*hex_encode)(const uint8_t*,size_t,char*);
+};
+// Every kernel set this CPU can run, fastest first (the bench compares them).
+inline std::vector<kernel> kernels(){
+  std::vector<kernel> k;
+#ifdef GZQR_TEXT_X86
+  if(__builtin_cpu_supports("avx2")) k.push_back({"avx2",b64_encode_avx2,b64_decode_blocks<32,b64_block_256>,hex_encode_avx2});
+  if(__builtin_cpu_supports("ssse3")) k.push_back({"ssse3",b64_encode_ssse3,b64_decode_blocks<16,b64_block_128>,hex_encode_ssse3});
+#endif
+  k.push_back({"scalar",b64_encode_scalar,b64_decode_scalar,hex_encode_scalar});
+  return k;
+}
+inline const kernel& active(){ static const kernel k=kernels().front(); return k; }
+
+// Writes b64_size(n) chars; returns that count.
+inline size_t b64_encode(const uint8_t* in,size_t n,char* out){ return active().b64_encode(in,n,out); }
+// Writes at most b64_decoded_max(n) bytes; returns the decoded length.
+inline size_t b64_decode(const char* in,size_t n,uint8_t* out){ return active().b64_decode(in,n,out); }
+// Writes 2n lowercase hex digits.
+inline void hex_encode(const uint8_t* in,size_t n,char* out){ active().hex_encode(in,n,out); }
+
+} // namespace gzqr::text
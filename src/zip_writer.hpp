@@ -0,0 +1,137 @@
+#pragma once
+/*
+ * GitZipQR.cpp – streaming ZIP writer
+ *
+ * Replaces `(cd dir && zip -r -q out.zip .)`: walks the directory with
+ * std::filesystem and writes a store-only ZIP straight into a byte_sink.
+ * Entries are sorted and relative to the root, and directories get their
+ * own "name/" entries, the same layout `zip -r .` produced. Each file is
+ * read once. Its CRC-32 is computed on the fly and written in a data
+ * descriptor after the data. ZIP64 records are used only when a size,
+ * offset or entry count needs them. Entries are stored, so every file's
+ * bytes sit in one piece in the stream; members() says where (used by the
+ * table of contents of indexed archives).
+ */
+#include "stream.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <ctime>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+#include <zlib.h>
+
+namespace gzqr {
+
+// A file in the archive: its bytes are [offset, offset+size) of the ZIP stream.
+struct zip_member { std::string name; uint64_t offset=0, size=0; };
+
+class zip_writer {
+public:
+  explicit zip_writer(byte_sink& out):out_(out){}
+
+  void add_dir(const std::string& name,uint32_t mode,std::time_t mtime){
+    entry e; e.name=name; e.mode=mode|S_IFDIR; e.dos=dos_time(mtime); e.offset=off_; e.dir=true;
+    local_header(e); entries_.push_back(e);
+  }
+  void add_file(const std::string& name,const std::string& path,uint32_t mode,std::time_t mtime,uint64_t sizeHint){
+    entry e; e.name=name; e.mode=mode|S_IFREG; e.dos=dos_time(mtime); e.offset=off_; e.zip64=sizeHint>=0xFFFFFFFFull;
+    local_header(e); e.data=off_;
+    FILE* f=fopen(path.c_str(),"rb"); if(!f) throw std::runtime_error("open "+path);
+    std::vector<uint8_t> b(1<<20); size_t n; uLong crc=crc32(0,nullptr,0);
+    try{ while((n=fread(b.data(),1,b.size(),f))>0){ crc=crc32(crc,b.data(),(uInt)n); e.size+=n; put(b.data(),n); } }catch(...){ fclose(f); throw; }
+    fclose(f);
+    if(!e.zip64 && e.size>=0xFFFFFFFFull) throw std::runtime_error("file grew past 4 GiB while archiving: "+path);
+    e.crc=(uint32_t)crc;
+    std::vector<uint8_t> d; u32(d,0x08074b50); u32(d,e.crc);
+    if(e.zip64){ u64(d,e.size); u64(d,e.size); } else { u32(d,(uint32_t)e.size); u32(d,(uint32_t)e.size); }
+    put(d); entries_.push_back(e);
+  }
+  std::vector<zip_member> members()const{
+    std::vector<zip_member> v;
+    for(const auto& e:entries_) if(!e.dir) v.push_back({e.name,e.data,e.size});
+    return v;
+  }
+  // Writes the central directory; the sink is not finished here.
+  void close(){
+    const uint64_t cdStart=off_;
+    for(const auto& e:entries_){
+      std::vector<uint8_t> x;   // ZIP64 extra: only the fields that overflow, in spec order
+      bool bigSize=e.size>=0xFFFFFFFFull, bigOff=e.offset>=0xFFFFFFFFull;
+      if(bigSize||bigOff){ u16(x,0x0001); u16(x,(bigSize?16:0)+(bigOff?8:0)); if(bigSize){ u64(x,e.size); u64(x,e.size); } if(bigOff) u64(x,e.offset); }
+      std::vector<uint8_t> h;
+      u32(h,0x02014b50); u16(h,(3<<8)|45); u16(h,need(e)); u16(h,flags(e)); u16(h,0);
+      u16(h,e.dos.second); u16(h,e.dos.first); u32(h,e.crc);
+      u32(h,bigSize?0xFFFFFFFFu:(uint32_t)e.size); u32(h,bigSize?0xFFFFFFFFu:(uint32_t)e.size);
+      u16(h,(uint16_t)e.name.size()); u16(h,(uint16_t)x.size()); u16(h,0); u16(h,0); u16(h,0);
+      u32(h,(e.mode<<16)|(e.dir?0x10:0)); u32(h,bigOff?0xFFFFFFFFu:(uint32_t)e.offset);
+      h.insert(h.end(),e.name.begin(),e.name.end()); h.insert(h.end(),x.begin(),x.end());
+      put(h);
+    }
+    const uint64_t cdSize=off_-cdStart, count=entries_.size();
+    std::vector<uint8_t> t;
+    if(count>=0xFFFF || cdSize>=0xFFFFFFFFull || cdStart>=0xFFFFFFFFull){
+      const uint64_t z64=off_;
+      u32(t,0x06064b50); u64(t,44); u16(t,(3<<8)|45); u16(t,45); u32(t,0); u32(t,0);
+      u64(t,count); u64(t,count); u64(t,cdSize); u64(t,cdStart);
+      u32(t,0x07064b50); u32(t,0); u64(t,z64); u32(t,1);
+    }
+    u32(t,0x06054b50); u16(t,0); u16(t,0);
+    u16(t,(uint16_t)std::min<uint64_t>(count,0xFFFF)); u16(t,(uint16_t)std::min<uint64_t>(count,0xFFFF));
+    u32(t,(uint32_t)std::min<uint64_t>(cdSize,0xFFFFFFFF)); u32(t,(uint32_t)std::min<uint64_t>(cdStart,0xFFFFFFFF)); u16(t,0);
+    put(t);
+  }
+
+private:
+  struct entry { std::string name; uint32_t mode=0, crc=0; std::pair<uint16_t,uint16_t> dos; uint64_t offset=0, data=0, size=0; bool dir=false, zip64=false; };
+
+  static uint16_t need(const entry& e){ return (e.zip64||e.size>=0xFFFFFFFFull||e.offset>=0xFFFFFFFFull)?45:20; }
+  static uint16_t flags(const entry& e){ return (uint16_t)((e.dir?0:0x0008)|0x0800); } // data descriptor, UTF-8 names
+  static std::pair<uint16_t,uint16_t> dos_time(std::time_t t){
+    std::tm tm{}; localtime_r(&t,&tm); if(tm.tm_year<80){ tm.tm_year=80; tm.tm_mon=0; tm.tm_mday=1; tm.tm_hour=tm.tm_min=tm.tm_sec=0; }
+    return { (uint16_t)(((tm.tm_year-80)<<9)|((tm.tm_mon+1)<<5)|tm.tm_mday), (uint16_t)((tm.tm_hour<<11)|(tm.tm_min<<5)|(tm.tm_sec/2)) };
+  }
+  void local_header(const entry& e){
+    if(e.name.size()>0xFFFF) throw std::runtime_error("path too long for zip: "+e.name);
+    std::vector<uint8_t> h;
+    u32(h,0x04034b50); u16(h,need(e)); u16(h,flags(e)); u16(h,0);
+    u16(h,e.dos.second); u16(h,e.dos.first); u32(h,0);
+    u32(h,e.zip64?0xFFFFFFFFu:0); u32(h,e.zip64?0xFFFFFFFFu:0);
+    u16(h,(uint16_t)e.name.size()); u16(h,e.zip64?20:0);
+    h.insert(h.end(),e.name.begin(),e.name.end());
+    if(e.zip64){ u16(h,0x0001); u16(h,16); u64(h,0); u64(h,0); }
+    put(h);
+  }
+  void put(const std::vector<uint8_t>& v){ put(v.data(),v.size()); }
+  void put(const uint8_t* p,size_t n){ out_.write(p,n); off_+=n; }
+  static void u16(std::vector<uint8_t>& v,uint16_t x){ v.push_back(x&255); v.push_back(x>>8); }
+  static void u32(std::vector<uint8_t>& v,uint32_t x){ for(int i=0;i<4;i++) v.push_back((x>>(8*i))&255); }
+  static void u64(std::vector<uint8_t>& v,uint64_t x){ for(int i=0;i<8;i++) v.push_back((x>>(8*i))&255); }
+
+  byte_sink& out_; uint64_t off_=0; std::vector<entry> entries_;
+};
+
+// Archives everything under `root` (paths relative to it, sorted) into `out`;
+// `members`, if given, receives where each file ended up.
+inline void zip_directory(const std::string& root,byte_sink& out,std::vector<zip_member>* members=nullptr){
+  namespace fs=std::filesystem;
+  std::vector<fs::path> paths;
+  for(auto it=fs::recursive_directory_iterator(root,fs::directory_options::skip_permission_denied); it!=fs::recursive_directory_iterator(); ++it)
+    paths.push_back(it->path());
+  std::sort(paths.begin(),paths.end());
+  zip_writer z(out);
+  for(const auto& p:paths){
+    // stat follows symlinks: a linked file is stored with its target's bytes,
+    // a linked directory as an empty directory (not walked, so links can't loop).
+    struct stat st{}; if(::stat(p.c_str(),&st)!=0) continue;
+    std::string rel=p.lexically_relative(root).generic_string();
+    if(S_ISDIR(st.st_mode)) z.add_dir(rel+"/",st.st_mode&07777,st.st_mtime);
+    else if(S_ISREG(st.st_mode)) z.add_file(rel,p.string(),st.st_mode&07777,st.st_mtime,(uint64_t)st.st_size);
+  }
+  z.close();
+  if(members) *members=z.members();
+}
+
+} // namespace gzqr
@@ -43,7 +43,7 @@ namespace mini_json {
     }
     static value parse_obj(const std::string&s,size_t&i){
       std::map<std::string,value> o; ++i; skipws(s,i); if(s[i]=='}'){++i;return value(o);}
-      while(true){ auto k=parse_str(s,i).str(); skipws(s,i); if(s[i++]!=':') throw std::runtime_error(":");
+      while(true){ skipws(s,i); auto k=parse_str(s,i).str(); skipws(s,i); if(s[i++]!=':') throw std::runtime_error(":");
         auto v=parse_any(s,i); o.emplace(k,std::move(v)); skipws(s,i);
         if(s[i]=='}'){++i;break;} if(s[i++]!=',') throw std::runtime_error(",");
       } return value(o);